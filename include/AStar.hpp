@@ -1,73 +1,224 @@
 #ifndef ASTAR_HPP
 #define ASTAR_HPP
 
-#include <functional>
+#include <iostream>
 #include <limits>
+#include <memory>
+#include <stdexcept>
 #include <vector>
 #include <algorithm>
 
+#include "GridMap.hpp"
+#include "Heuristics.hpp"
 #include "Node.hpp"
+#include "SearchWorkspace.hpp"
+#include "ShortestPathAlgorithm.hpp"
+#include "TraceEvents.hpp"
 
-using HeuristicFunction = std::function<double(int, int, int, int)>;
-
-const std::vector<HeuristicFunction> heuristicFunctions = {
-    [](int x, int y, int endX, int endY){ return 0; },
-    [](int x, int y, int endX, int endY){ return ( std::max( std::abs(endX - x), std::abs(endY - y) ) ) ; },
-    [](int x, int y, int endX, int endY){ return ( std::abs(endX - x) + std::abs(endY - y) ); },
-    [](int x, int y, int endX, int endY){ return std::sqrt( std::pow(endX - x, 2) + std::pow(endY - y, 2) ); }    
-};
-
-
-class AStar
+class AStar : public ShortestPathAlgorithm
 {
   private:
-    PathSet openSet_
-          , closeSet_;
-    std::vector<bool> obstacles_;
-    int h_;  // Position of the heuristic function array
+    unsigned N_
+           , M_;
+    int h_;  // Number of the heuristic function, see Heuristics.hpp
+    std::shared_ptr<const GridMap> map_;              // It can be shared by many searches
+    std::shared_ptr<SearchWorkspace> workspace_;      // Open set and state of each cell, indexed like
+                                                      // the cells of map_. It can be reused by later searches
     bool finished_;
     Path startNode_
        , endNode_;
-    unsigned N_
-           , M_;
-    std::vector<sf::Vector2u> shortestPath_;
+    std::vector<GridPos> shortestPath_;
+    TracePhase searchTrace_;   // From the first iteration to the end of the search
 
-  public:
-    std::vector<sf::Vector2u> lastAdditionsToOpen;
-    sf::Vector2u lastAdditionToClose;
+    // Instantiation of expandNeighbours for the heuristic h_, chosen once at construction
+    void (AStar::*expandNeighbours_)( const Path& current );
+
+  private:
+    std::size_t cellIndex( const GridPos& pos )const{ return map_->index( pos ); }
+
+    // Walks the moves back from the goal to build the shortest path
+    void buildShortestPath()
+    {
+        TRACE_SCOPE( "AStar::buildShortestPath", "search" );
+        const auto start = SearchStatistics::now();
+        GridPos pos = endNode_.pos();
+        shortestPath_.assign( 1, pos );
+
+        for( unsigned move = workspace_->parentMove( cellIndex( pos ) );
+             move != SearchWorkspace::NO_PARENT;
+             move = workspace_->parentMove( cellIndex( pos ) ) )
+        {
+            pos = { pos.x - Node::NEIGHBOURS[move].x, pos.y - Node::NEIGHBOURS[move].y };
+            shortestPath_.push_back( pos );
+        }
+
+        std::reverse( shortestPath_.begin(), shortestPath_.end() );
+        statistics_.addTime( statistics_.pathMs, start );
+    }
+
+    // Adds the neighbours of current to the open set. It is instantiated for
+    // each heuristic so its calls are inlined in the loop
+    template<class Heuristic>
+    void expandNeighbours( const Path& current )
+    {
+        const Heuristic heuristic;
+        const GridMap& map = *map_;
+        SearchWorkspace& workspace = *workspace_;
+        const GridPos pos = current.pos();
+        const std::size_t cell = map.index( pos );
+        const int endX = endNode_.pos().x
+                , endY = endNode_.pos().y;
+        const double newG = current.g() + 1;
+
+        // Only the free neighbours inside the map are visited, one for each bit of the mask
+        for( unsigned mask = map.freeNeighbours( cell );  mask != 0;  mask &= mask - 1 )
+        {
+            const unsigned i = __builtin_ctz( mask )
+                         , posX = pos.x + Node::NEIGHBOURS[i].x
+                         , posY = pos.y + Node::NEIGHBOURS[i].y;
+            const std::size_t index = map.index( posX, posY );
+
+            // If we already have a path to this cell, in the open or in the
+            // close set, that is not worse than the new one we do nothing with it
+            if( workspace.g( index ) <= newG )
+            {
+                statistics_.duplicate();
+                continue;
+            }
+
+            if( SearchStatistics::ENABLED  &&  workspace.state( index ) == SearchWorkspace::CLOSED )
+                statistics_.reopenedNode();
+
+            // Construct new path
+            Path newPath = current;
+            newPath.update(
+                {posX, posY},
+                1, heuristic( posX, posY, endX, endY )
+            );
+
+            // Add the new path to the open set. If it is already there its cost
+            // is updated, and if it was closed it is opened again
+            workspace.openSet.insertAndKeepMinimum( newPath );
+            workspace.open( index, newG, i );
+            lastAdditionsToOpen.push_back( newPath.pos() );
+            statistics_.generated();
+            statistics_.heuristicCall();
+        }
+    }
 
   public:
     AStar(
-        unsigned M, unsigned N,
+        std::shared_ptr<const OccupancyGrid> obstacles,
         unsigned startX, unsigned startY, 
         unsigned endX, unsigned endY,
-        const std::vector<bool>& obstacles,
         unsigned h
     ):
-      M_( M ), N_( N ),
-      h_( (h < heuristicFunctions.size()) ? h : 0 ),
-      finished_( false ),
+      AStar( std::make_shared<const GridMap>( obstacles ), startX, startY, endX, endY, h )
+    {}
+
+    // The map is not copied, so many searches can use the same one
+    AStar(
+        std::shared_ptr<const GridMap> map,
+        unsigned startX, unsigned startY,
+        unsigned endX, unsigned endY,
+        unsigned h
+    ):
+      AStar(
+          map,
+          std::make_shared<SearchWorkspace>( map, hasIntegralValues( h ) ), // Bucket queue when the f values are integers
+          startX, startY, endX, endY, h
+      )
+    {}
+
+    // The workspace keeps its memory from previous searches on the same map, so
+    // the search does not allocate its per cell state. It must have been built
+    // for a map of the same size and layout, and for a heuristic with the same kind of values, otherwise
+    // std::invalid_argument is thrown
+    AStar(
+        std::shared_ptr<const GridMap> map,
+        std::shared_ptr<SearchWorkspace> workspace,
+        unsigned startX, unsigned startY,
+        unsigned endX, unsigned endY,
+        unsigned h
+    ):
+      M_( map->numRows() ), N_( map->numCols() ),
+      h_( (h < NUMBER_OF_HEURISTIC_FUNCTIONS) ? h : 0 ),
+      map_( map ),
+      workspace_( workspace ),
       startNode_(),
       endNode_(),
-      obstacles_( obstacles )
+      searchTrace_( "AStar::search", "search" )
     {
+        if( !workspace_->fits( *map_ )  ||  workspace_->hasIntegralCosts() != hasIntegralValues( h ) )
+            throw std::invalid_argument( "The search workspace does not match the map or the heuristic." );
+
+        expandNeighbours_ = visitHeuristic( h_, []( auto heuristic ){
+            return &AStar::expandNeighbours< decltype(heuristic) >;
+        });
+
+        reset( startX, startY, endX, endY );
+        finishSetup();
+    }
+
+    // Prepares the search for new start and end positions on the same map,
+    // reusing the memory of the previous one. It does not depend on the size of the map
+    void reset( unsigned startX, unsigned startY, unsigned endX, unsigned endY )
+    {
+        // A search left unfinished ends here
+        searchTrace_.end();
+        TRACE_SCOPE( "AStar::reset", "search" );
+        statistics_.reset();
+        const auto start = SearchStatistics::now();
+        finished_ = false;
+        workspace_->reset();
+        shortestPath_.clear();
+
+        startNode_ = Path();
         startNode_.update(
             {startX, startY},
             0,
-            heuristicFunctions[h](startX, startY, endX, endY)
+            visitHeuristic( h_, [&]( auto heuristic ){ return heuristic( startX, startY, endX, endY ); } )
         );
+        endNode_ = Path();
         endNode_.update(
             {endX, endY},
             0,
             0            
         );
 
-        openSet_.insert( startNode_ );
+        workspace_->openSet.insert( startNode_ );
+        workspace_->open( cellIndex( startNode_.pos() ), 0, SearchWorkspace::NO_PARENT );
+        statistics_.generated();
+        statistics_.heuristicCall();
+        statistics_.openSize( 1 );
+        statistics_.addTime( statistics_.setupMs, start );
     }
       
-    const std::vector<sf::Vector2u>& getShortestPath()const{ return shortestPath_; }
+    const std::vector<GridPos>& getShortestPath()const override{ return shortestPath_; }
 
-    bool nextIteration( bool debugInfo = true )
+    // To give the memory of this search to the next one on the same map
+    std::shared_ptr<SearchWorkspace> workspace()const{ return workspace_; }
+
+    bool nextIteration( bool debugInfo = true )override
+    {
+        // The iterations are traced together, a scope in each one would take
+        // longer than the iteration and fill the trace with an event per expansion
+        searchTrace_.begin();
+        statistics_.iterationStarted();
+        const bool finished = step( debugInfo );
+
+        if( finished )
+        {
+            searchTrace_.end();
+            statistics_.searchFinished();
+            statistics_.memory( workspace_->bytes() + shortestPath_.capacity() * sizeof(GridPos) );
+        }
+        return finished;
+    }
+
+  private:
+    // One iteration of the search, nextIteration() keeps its statistics
+    bool step( bool debugInfo )
     {
         lastAdditionToClose = {};
         lastAdditionsToOpen.clear();
@@ -81,14 +232,14 @@ class AStar
             return true;
         
         // Check if the open set has no elements -> no solution
-        if( openSet_.empty() )
+        if( workspace_->openSet.empty() )
         {
             finished_ = true;
             return true;
         }
         
         // Get node with lowest f value
-        Path current = openSet_.getLowest();
+        Path current = workspace_->openSet.getLowest();
         
         // Info for debugging
         if( debugInfo )
@@ -101,52 +252,22 @@ class AStar
         if( current == endNode_ )
         {
             // Build shortest path and finish
-            shortestPath_ = current.getPath();
+            buildShortestPath();
             finished_ = true;
             return true;
         }
 
         // Erase current node from open set and add it to the close set
-        openSet_.remove( current );
-        closeSet_.insertAndKeepMinimum( current );
+        workspace_->openSet.remove( current );
+        workspace_->close( cellIndex( current.pos() ) );
         lastAdditionToClose = current.pos();
+        statistics_.expanded();
 
-        // Check current node neighbours
-        for( int i = 0; i < Node::NEIGHBOURS.size(); ++i )
-        {
-            const auto& pos = current.pos();
-            int posX = pos.x + Node::NEIGHBOURS[i].x
-              , posY = pos.y + Node::NEIGHBOURS[i].y;
-
-            // Checking boundaries. If this is not a valid node we skip it
-            if( posX < 0  ||  posX >= M_  ||  posY < 0  ||  posY >= N_ ) 
-                continue;
-
-            // Construct new path
-            double heuristicVal = heuristicFunctions[h_]( posX, posY, endNode_.pos().x, endNode_.pos().y );
-            Path newPath = current;
-            newPath.update(
-                {(unsigned)posX, (unsigned)posY},
-                1, heuristicVal 
-            );
+        // Add its neighbours to the open set
+        (this->*expandNeighbours_)( current );
+        statistics_.openSize( workspace_->openSet.size() );
 
-            // Checking obstacles. If this node is an obstacle we skip it            
-            if( obstacles_[ posX * N_ + posY ] )
-                continue;
-                        
-            // If the new path is already in the close set and
-            // the one there is better, we do nothing with this path
-            Path pathInCloseSet = closeSet_.get(newPath);
-            if( !pathInCloseSet.empty()  &&  pathInCloseSet < newPath )
-                continue;
-  
-            // Try to add the new path to the open set. If it is already in the
-            // open set we update the cost of it to the minimum one.
-            // If the node was inserted this method will return true
-            // If the old node remains because is better, this will return false
-            if( openSet_.insertAndKeepMinimum( newPath ) )
-                lastAdditionsToOpen.push_back( newPath.pos() );
-       }
+        return false;
     }
     
 };
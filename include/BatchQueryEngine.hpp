@@ -0,0 +1,71 @@
+#ifndef BATCH_QUERY_ENGINE_HPP
+#define BATCH_QUERY_ENGINE_HPP
+
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "AStar.hpp"
+#include "GridMap.hpp"
+#include "Node.hpp"
+
+// A start and goal pair to solve on the map of the engine
+struct PathQuery
+{
+    GridPos start
+          , goal;
+};
+
+struct PathQueryResult
+{
+    std::vector<GridPos> path; // From the start to the goal, empty if there is no path
+    long expansions;
+    std::string error;         // Why the query could not be solved, empty if it was
+};
+
+// Solves many queries on the same map with a pool of threads. The map is loaded
+// once and shared read only by every worker, and each worker keeps its own AStar
+// between queries so its memory is reused. The queries are split between the
+// workers, and a worker that runs out of queries steals them from the others.
+class BatchQueryEngine
+{
+  private:
+    // Indexes of the queries that a worker has to solve. The owner takes them from
+    // the front and the other workers steal them from the back
+    struct WorkQueue
+    {
+        std::mutex mutex;
+        std::deque<std::size_t> queries;
+    };
+
+    std::shared_ptr<const GridMap> map_;
+    std::vector<std::unique_ptr<AStar>> searches_; // Search state of each worker
+
+  private:
+    // Takes a query from the queue of worker, or steals one from another worker.
+    // Returns false when there are no queries left.
+    bool takeQuery( unsigned worker, std::vector<WorkQueue>& queues, std::size_t& query )const;
+
+    void work( unsigned worker, std::vector<WorkQueue>& queues,
+               const std::vector<PathQuery>& queries, std::vector<PathQueryResult>& results );
+
+  public:
+    // h is the heuristic number. With 0 workers one is used for each hardware thread.
+    BatchQueryEngine(
+        std::shared_ptr<const GridMap> map,
+        unsigned h,
+        unsigned numberOfWorkers = 0
+    );
+
+    unsigned numberOfWorkers()const{ return searches_.size(); }
+
+    // Solves the queries, the result i belongs to the query i. A query that
+    // cannot be solved, because a position is outside the map or on an obstacle,
+    // gets the reason in its error and does not stop the others.
+    std::vector<PathQueryResult> solve( const std::vector<PathQuery>& queries );
+};
+
+#endif // BATCH_QUERY_ENGINE_HPP
@@ -0,0 +1,262 @@
+#ifndef BIDIRECTIONAL_ASTAR_HPP
+#define BIDIRECTIONAL_ASTAR_HPP
+
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <vector>
+#include <algorithm>
+
+#include "GridMap.hpp"
+#include "Heuristics.hpp"
+#include "Node.hpp"
+#include "ShortestPathAlgorithm.hpp"
+
+// A* that searches at the same time from the start to the goal and from the goal
+// to the start, and builds the path where both searches meet. Each iteration
+// expands one node of the side with the smallest open set.
+//
+// Both sides use the average of the heuristic to the goal and from the start:
+// p(v) = (h(v, goal) - h(v, start)) / 2 for the forward side and -p(v) for the
+// backward one. With a consistent heuristic, both sides then see the same
+// non-negative edge costs. Every time a side reaches a cell already reached by
+// the other one, the cost of the path through that cell is a candidate for the
+// best path. The search stops when the sum of the lowest f values of both open
+// sets is not lower than the best candidate, because no path through the open
+// sets can be better.
+class BidirectionalAStar : public ShortestPathAlgorithm
+{
+  private:
+    enum : std::size_t { NO_PARENT = ~std::size_t(0) };
+    enum CellState : unsigned char { UNVISITED, OPEN, CLOSED };
+
+    // The search from one of the ends. All the vectors are indexed like the cells of map_
+    struct Direction
+    {
+        BasicPathSet<MapPathSlots> openSet;
+        int potentialSign;                 // +1 for the forward side and -1 for the backward one
+        std::vector<std::size_t> parent;   // Predecessor of each cell towards the origin of this side
+        std::vector<unsigned char> state;
+        std::vector<double> bestG;         // Cost from the origin of this side to each cell
+
+        Direction( std::shared_ptr<const GridMap> map, int sign ):
+          openSet( MapPathSlots( map, false ), false ),
+          potentialSign( sign ),
+          parent( map->size(), NO_PARENT ),
+          state( map->size(), UNVISITED ),
+          bestG( map->size(), std::numeric_limits<double>::infinity() )
+        {}
+    };
+
+    unsigned M_  // Number of rows
+           , N_; // Number of columns
+    std::shared_ptr<const GridMap> map_;  // Shared with the open sets
+    int h_;  // Number of the heuristic function, see Heuristics.hpp
+    bool finished_;
+    GridPos start_
+          , end_;
+    Direction forward_    // From the start to the goal
+            , backward_;  // From the goal to the start
+    double bestPathCost_; // Cost of the best path found through a meeting cell
+    std::size_t meetingCell_; // Cell where both searches meet in the best path, or NO_PARENT
+    std::vector<GridPos> shortestPath_;
+
+    // Instantiation of expandNeighbours for the heuristic h_, chosen once at construction
+    void (BidirectionalAStar::*expandNeighbours_)( Direction& side, const Direction& other, const Path& current );
+
+  private:
+    std::size_t cellIndex( const GridPos& pos )const{ return map_->index( pos ); }
+
+    // Joins the path from the start to the meeting cell with the one from there to the goal
+    void buildShortestPath()
+    {
+        const auto start = SearchStatistics::now();
+        shortestPath_.clear();
+
+        for( std::size_t cell = meetingCell_;  cell != NO_PARENT;  cell = forward_.parent[cell] )
+            shortestPath_.push_back( map_->pos( cell ) );
+
+        std::reverse( shortestPath_.begin(), shortestPath_.end() );
+
+        for( std::size_t cell = backward_.parent[ meetingCell_ ];  cell != NO_PARENT;  cell = backward_.parent[cell] )
+            shortestPath_.push_back( map_->pos( cell ) );
+
+        statistics_.addTime( statistics_.pathMs, start );
+    }
+
+    // Adds the neighbours of current to the open set of side, and updates the best
+    // path when one of them has already been reached by the other side
+    template<class Heuristic>
+    void expandNeighbours( Direction& side, const Direction& other, const Path& current )
+    {
+        const Heuristic heuristic;
+        const GridPos pos = current.pos();
+        const std::size_t cell = cellIndex( pos );
+        const double newG = current.g() + 1;
+
+        // Only the free neighbours inside the map are visited, one for each bit of the mask
+        for( unsigned mask = map_->freeNeighbours( cell );  mask != 0;  mask &= mask - 1 )
+        {
+            const unsigned i = __builtin_ctz( mask );
+            const int posX = pos.x + Node::NEIGHBOURS[i].x
+                    , posY = pos.y + Node::NEIGHBOURS[i].y;
+            const std::size_t index = map_->index( posX, posY );
+
+            // If this side already has a path to the cell that is not worse we do nothing with it
+            if( side.state[ index ] != UNVISITED  &&  side.bestG[ index ] <= newG )
+            {
+                statistics_.duplicate();
+                continue;
+            }
+
+            if( side.state[ index ] == CLOSED )
+                statistics_.reopenedNode();
+
+            const double potential = side.potentialSign * 0.5 *
+                ( heuristic( posX, posY, end_.x, end_.y ) - heuristic( posX, posY, start_.x, start_.y ) );
+            statistics_.heuristicCall( 2 );
+
+            Path newPath = current;
+            newPath.update( {(unsigned)posX, (unsigned)posY}, 1, potential );
+
+            side.openSet.insertAndKeepMinimum( newPath );
+            side.state[ index ] = OPEN;
+            side.bestG[ index ] = newG;
+            side.parent[ index ] = cell;
+            lastAdditionsToOpen.push_back( newPath.pos() );
+            statistics_.generated();
+
+            // Both searches meet in this cell
+            if( other.state[ index ] != UNVISITED  &&  newG + other.bestG[ index ] < bestPathCost_ )
+            {
+                bestPathCost_ = newG + other.bestG[ index ];
+                meetingCell_ = index;
+            }
+        }
+    }
+
+  public:
+    BidirectionalAStar(
+        std::shared_ptr<const OccupancyGrid> obstacles,
+        unsigned startX, unsigned startY,
+        unsigned endX, unsigned endY,
+        unsigned h
+    ):
+      M_( obstacles->numRows() ), N_( obstacles->numCols() ),
+      map_( std::make_shared<const GridMap>( obstacles ) ),
+      h_( (h < NUMBER_OF_HEURISTIC_FUNCTIONS) ? h : 0 ),
+      finished_( false ),
+      start_( {startX, startY} ),
+      end_( {endX, endY} ),
+      forward_( map_, +1 ),
+      backward_( map_, -1 ),
+      bestPathCost_( std::numeric_limits<double>::infinity() ),
+      meetingCell_( NO_PARENT )
+    {
+        expandNeighbours_ = visitHeuristic( h_, []( auto heuristic ){
+            return &BidirectionalAStar::expandNeighbours< decltype(heuristic) >;
+        });
+
+        const double potential = 0.5 * visitHeuristic( h_, [&]( auto heuristic ){
+            return heuristic( startX, startY, endX, endY );
+        });
+
+        // Each side starts from its own end
+        Path start, end;
+        start.update( {startX, startY}, 0, potential );
+        end.update( {endX, endY}, 0, potential );
+
+        for( auto side : { std::make_pair( &forward_, start ), std::make_pair( &backward_, end ) } )
+        {
+            side.first->openSet.insert( side.second );
+            side.first->state[ cellIndex( side.second.pos() ) ] = OPEN;
+            side.first->bestG[ cellIndex( side.second.pos() ) ] = 0;
+        }
+
+        if( start == end )
+        {
+            bestPathCost_ = 0;
+            meetingCell_ = cellIndex( start.pos() );
+        }
+
+        statistics_.generated( 2 );
+        statistics_.heuristicCall();
+        statistics_.openSize( 2 );
+        finishSetup();
+    }
+
+    const std::vector<GridPos>& getShortestPath()const override{ return shortestPath_; }
+
+    bool nextIteration( bool debugInfo = true )override
+    {
+        statistics_.iterationStarted();
+        const bool finished = step( debugInfo );
+
+        if( finished )
+        {
+            statistics_.searchFinished();
+            std::size_t bytes = map_->bytes() + shortestPath_.capacity() * sizeof(GridPos);
+            for( const Direction* side : { &forward_, &backward_ } )
+                bytes += side->openSet.bytes() + side->parent.capacity() * sizeof(std::size_t)
+                       + side->state.capacity() + side->bestG.capacity() * sizeof(double);
+            statistics_.memory( bytes );
+        }
+        return finished;
+    }
+
+  private:
+    // One iteration of the search, nextIteration() keeps its statistics
+    bool step( bool debugInfo )
+    {
+        lastAdditionToClose = {};
+        lastAdditionsToOpen.clear();
+        lastAdditionsToOpen.reserve( Node::NEIGHBOURS.size() );
+
+        if( finished_ )
+            return true;
+
+        // If one of the sides has nothing else to expand, no other path can be found
+        if( forward_.openSet.empty()  ||  backward_.openSet.empty() )
+        {
+            if( meetingCell_ != NO_PARENT )
+                buildShortestPath();
+            finished_ = true;
+            return true;
+        }
+
+        // Stopping criterion: no path through the open sets can be better than the best one
+        if( bestPathCost_ <= forward_.openSet.getLowest().f() + backward_.openSet.getLowest().f() )
+        {
+            buildShortestPath();
+            finished_ = true;
+            return true;
+        }
+
+        // Expand the side with less open nodes
+        const bool expandForward = forward_.openSet.size() <= backward_.openSet.size();
+        Direction& side = expandForward ? forward_ : backward_;
+        const Direction& other = expandForward ? backward_ : forward_;
+
+        Path current = side.openSet.getLowest();
+
+        if( debugInfo )
+        {
+            std::cerr << ( expandForward ? "Forward" : "Backward" ) << " current pos: ("
+                      << current.pos().x << ',' << current.pos().y << ")\n";
+            std::cerr << "Cost: " << current.g() << ", h: " << current.h() << ", f: " << current.f()
+                      << ", best path: " << bestPathCost_ << '\n';
+        }
+
+        side.openSet.remove( current );
+        side.state[ cellIndex( current.pos() ) ] = CLOSED;
+        lastAdditionToClose = current.pos();
+        statistics_.expanded();
+
+        (this->*expandNeighbours_)( side, other, current );
+        statistics_.openSize( forward_.openSet.size() + backward_.openSet.size() );
+
+        return false;
+    }
+};
+
+#endif // BIDIRECTIONAL_ASTAR_HPP
@@ -2,10 +2,20 @@
 #define CLASS_GRAPHIC_GRID_HPP
 
 #include <SFML/Graphics.hpp>
+#include <vector>
 
 // Inherits from Drawable so we can overload the draw function
 class GraphicGrid : public sf::Drawable
 {
+  public:
+    // How the cells are kept and drawn
+    enum RenderMode
+    {
+        SPRITE_CHUNKS,  // 4 vertices per cell, about 80 bytes, in chunks of vertex buffers
+        CELL_STATES     // 1 byte per cell. When zoomed out the grid is drawn as textures with a
+                        // pixel per cell, and when zoomed in as the sprites of the visible cells
+    };
+
   private:
     const int M_  // Number of columns
             , N_; // Number of rows
@@ -15,12 +25,81 @@ class GraphicGrid : public sf::Drawable
                      , texSz_;     // The size of each sprite texture in the sprite sheet
 
     const sf::Texture spriteSheet_;   // Holds the texture object of the sprite sheet to use
-        
-    sf::VertexArray cells_;     // Holds the vertices of the cells, the size will be M*N*4 because
-                                // each cell has 4 vertices
+
+    // The cells are split in chunks of CHUNK_CELLS x CHUNK_CELLS, and each chunk keeps its
+    // vertices in a buffer of the graphics card. Changing a cell marks its vertices as dirty,
+    // and draw() only uploads the dirty vertices, so during a search a frame sends the few
+    // cells that the last step changed instead of the whole grid.
+    enum { CHUNK_CELLS = 64 };
+
+    struct Chunk
+    {
+        unsigned firstX, firstY   // Position of the first cell of the chunk
+               , width, height;   // Number of cells of the chunk along x and along y
+        std::vector<sf::Vertex> vertices;   // 4 per cell, the cells of a value of x together
+        mutable sf::VertexBuffer buffer;    // Created the first time the chunk is drawn
+        mutable std::size_t dirtyBegin      // Range of vertices changed since they were uploaded
+                          , dirtyEnd;
+
+        Chunk( unsigned firstX, unsigned firstY, unsigned width, unsigned height );
+
+        // The 4 vertices of a cell of the chunk
+        std::size_t vertexIndex( unsigned x, unsigned y )const{ return ( (std::size_t)(x - firstX) * height + (y - firstY) ) * 4; }
+
+        // Uploads the dirty vertices, if the buffer can be used, and draws them
+        void draw( sf::RenderTarget& target, const sf::RenderStates& states )const;
+    };
+
+    std::vector<Chunk> chunks_;
+    unsigned chunksAlongY_;     // Number of chunks for each value of x / CHUNK_CELLS
+
+    Chunk& chunkOf( unsigned x, unsigned y ){ return chunks_[ (x / CHUNK_CELLS) * chunksAlongY_ + y / CHUNK_CELLS ]; }
+
+    // In CELL_STATES mode each cell keeps the number of its sprite, counted by rows of the
+    // sprite sheet, and the grid is split in tiles of STATE_TILE_CELLS x STATE_TILE_CELLS
+    // cells, each one a texture with the average color of the sprite of each cell. The
+    // sprites are drawn when a cell takes MIN_SPRITE_PX pixels of the window or more.
+    // Changing a cell grows the dirty box of its tile, and only that box is uploaded.
+    enum { STATE_TILE_CELLS = 1024, MIN_SPRITE_PX = 8 };
+
+    struct StateTile
+    {
+        unsigned firstX, firstY   // Position of the first cell of the tile
+               , width, height;   // Number of cells of the tile along x and along y
+        unsigned dirtyFirstX, dirtyFirstY   // Box [first, last) of the pixels changed since they
+               , dirtyLastX, dirtyLastY;    // were uploaded, empty if dirtyFirstX >= dirtyLastX
+        sf::Texture texture;           // Pixel (x, y) is the cell (firstX + x, firstY + y)
+    };
+
+    StateTile& stateTileOf( unsigned x, unsigned y ){ return stateTiles_[ (x / STATE_TILE_CELLS) * stateTilesAlongY_ + y / STATE_TILE_CELLS ]; }
+
+    const RenderMode renderMode_;
+    unsigned sheetColumns_;                // Number of sprites in a row of the sprite sheet
+    std::vector<unsigned char> states_;    // Sprite of each cell, indexed x * N + y
+    std::vector<sf::Color> stateColors_;   // Average color of each sprite
+    mutable std::vector<StateTile> stateTiles_;    // Their textures are updated when they are drawn
+    unsigned stateTilesAlongY_;
+    mutable bool texturesCreated_;                  // The textures are created when first drawn
+    mutable std::vector<sf::Vertex> spriteVertices_; // Sprites of the visible cells when zoomed in
+
+    // Sets the 4 vertices of the cell (x, y), showing the sprite at texPos of the sprite sheet
+    void setCellVertices( sf::Vertex* cell, unsigned x, unsigned y, const sf::Vector2u& texPos )const;
+
+    // Range [first, last) of the cells along each axis that the view shows. Returns false if none
+    bool visibleCells( const sf::View& view, int& firstX, int& lastX, int& firstY, int& lastY )const;
+
+    // Draws the visible cells in CELL_STATES mode
+    void drawCellStates( sf::RenderTarget& target, sf::RenderStates states,
+                         int firstX, int lastX, int firstY, int lastY )const;
+
+    // Uploads the dirty box of each tile, with the colors of the states of its cells
+    void uploadStateTiles()const;
 
     const unsigned MIN_CELL_SZ; // Minimum length (in px) for a side of a cell
 
+    // Width and height in px of each cell
+    sf::Vector2u cellSize()const;
+
     // Private constructor, objects have to be created with the static init method
     GraphicGrid(
         const sf::Vector2u& gridStart,    // Point in the window that is the top left corner of the grid
@@ -29,7 +108,8 @@ class GraphicGrid : public sf::Drawable
         const int N,                      // Number of rows in the grid
         const sf::Texture& spriteSheet,   // Holds the texture object of the sprite sheet to use
         const sf::Vector2u& texSz,        // Size of each sprite texture in the sprite sheet
-        const sf::Vector2u& defaultTexPos // Position of the texture sprite in the sheet to put in the cells as default
+        const sf::Vector2u& defaultTexPos, // Position of the texture sprite in the sheet to put in the cells as default
+        RenderMode renderMode             // How the cells are kept and drawn
     );
 
     
@@ -44,7 +124,8 @@ class GraphicGrid : public sf::Drawable
         const int N,                      // Number of rows in the grid
         const std::string& spriteSheetLocation,   // Location in the file system of the spriteSheet to use
         const sf::Vector2u& texSz,        // Size of each sprite texture in the sprite sheet
-        const sf::Vector2u& defaultTexPos = {0, 0} // Position of the texture sprite in the sheet to put in the cells as default        
+        const sf::Vector2u& defaultTexPos = {0, 0}, // Position of the texture sprite in the sheet to put in the cells as default        
+        RenderMode renderMode = SPRITE_CHUNKS       // How the cells are kept and drawn
     );
     
     // Copies are not allowed, moves are
@@ -56,13 +137,18 @@ class GraphicGrid : public sf::Drawable
     virtual ~GraphicGrid(){}    
 
     // No need to use this method directly. By overloading this function we can use instances of this
-    // class as argument to the draw method of a render target.
+    // class as argument to the draw method of a render target. Only the cells inside the view of
+    // the target are drawn, so the cost depends on the zoom and not on the size of the grid.
     virtual void draw( sf::RenderTarget& target, sf::RenderStates states )const;
 
     // Given a cell position and a sprite texture position we change the texture that
     // the cell has to the new texture.
     void changeCellTexture( const sf::Vector2u& cellPos, const sf::Vector2u& texPosInSpriteSheet );
 
+    // Given a point in the coordinates of the grid (the ones of the camera view) we get
+    // the position of the cell that contains it. Returns false if it is outside the grid.
+    bool cellAt( const sf::Vector2f& point, sf::Vector2u& cellPos )const;
+
     // Getters
     // These are made so the main doesn't have to be polluted with useless variables
     // that grid objects already holds
@@ -0,0 +1,332 @@
+#ifndef DSTAR_LITE_HPP
+#define DSTAR_LITE_HPP
+
+#include <algorithm>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <set>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "Heuristics.hpp"
+#include "Node.hpp"
+#include "OccupancyGrid.hpp"
+#include "ShortestPathAlgorithm.hpp"
+
+// D* Lite: incremental search for maps whose obstacles change. It searches from
+// the goal to the start, keeping for each cell its cost to the goal (g) and a
+// one step lookahead of it (rhs). When obstacles are added or removed only the
+// cells whose cost changes are expanded again, so replanning after a small
+// change costs a fraction of a new search.
+class DStarLite : public ShortestPathAlgorithm
+{
+  private:
+    // Priority of a cell in the open set, compared lexicographically
+    using Key = std::pair<double, double>;
+
+    unsigned M_  // Number of rows
+           , N_; // Number of columns
+    std::vector<bool> obstacles_;  // Its own copy of the map, because it changes, indexed x * N + y
+    int h_;  // Number of the heuristic function, see Heuristics.hpp
+    bool finished_;
+    std::size_t start_
+              , end_;
+
+    // Both indexed x * N + y
+    std::vector<double> g_
+                      , rhs_;
+
+    // Open set: the cells whose g and rhs differ, ordered by key
+    std::set<std::pair<Key, std::size_t>> openSet_;
+    std::vector<Key> openKey_;    // Key of each cell in the open set
+    std::vector<bool> isOpen_;
+    std::vector<GridPos> shortestPath_;
+
+  private:
+    static double infinity(){ return std::numeric_limits<double>::infinity(); }
+
+    GridPos cellPos( std::size_t cell )const{ return { unsigned( cell / N_ ), unsigned( cell % N_ ) }; }
+
+    double heuristic( std::size_t from, std::size_t to )const
+    {
+        return visitHeuristic( h_, [&]( auto heuristic ){
+            return heuristic( unsigned( from / N_ ), unsigned( from % N_ ), unsigned( to / N_ ), unsigned( to % N_ ) );
+        });
+    }
+
+    Key calculateKey( std::size_t cell )const
+    {
+        const double g = std::min( g_[cell], rhs_[cell] );
+        return { g + heuristic( start_, cell ), g };
+    }
+
+    // Calls f with each free neighbour of the cell. Moving to or from an obstacle
+    // has infinite cost, so those edges are not considered
+    template<class Function>
+    void forEachNeighbour( std::size_t cell, Function f )const
+    {
+        const int x = cell / N_
+                , y = cell % N_;
+
+        for( const GridOffset& offset : Node::NEIGHBOURS )
+        {
+            const int posX = x + offset.x
+                    , posY = y + offset.y;
+
+            if( posX < 0  ||  posX >= (int)M_  ||  posY < 0  ||  posY >= (int)N_ )
+                continue;
+
+            const std::size_t neighbour = (std::size_t)posX * N_ + posY;
+            if( !obstacles_[ neighbour ] )
+                f( neighbour );
+        }
+    }
+
+    // Lowest cost to the goal through the neighbours of the cell
+    double lookahead( std::size_t cell )const
+    {
+        if( cell == end_ )
+            return 0;
+
+        double best = infinity();
+        if( !obstacles_[cell] )
+            forEachNeighbour( cell, [&]( std::size_t next ){ best = std::min( best, 1 + g_[next] ); } );
+        return best;
+    }
+
+    void removeFromOpen( std::size_t cell )
+    {
+        if( isOpen_[cell] )
+        {
+            openSet_.erase( { openKey_[cell], cell } );
+            isOpen_[cell] = false;
+        }
+    }
+
+    // Puts the cell in the open set with its current key if it is inconsistent
+    void updateCell( std::size_t cell )
+    {
+        removeFromOpen( cell );
+
+        if( g_[cell] != rhs_[cell] )
+        {
+            openKey_[cell] = calculateKey( cell );
+            openSet_.insert( { openKey_[cell], cell } );
+            isOpen_[cell] = true;
+            lastAdditionsToOpen.push_back( cellPos( cell ) );
+            statistics_.generated();
+            statistics_.heuristicCall();
+            statistics_.openSize( openSet_.size() );
+        }
+    }
+
+    // Follows the lowest cost neighbours from the start to the goal
+    void buildShortestPath()
+    {
+        shortestPath_.clear();
+
+        if( rhs_[start_] == infinity() )
+            return;
+
+        // The length of the path is bounded, in case the costs are not repaired yet
+        std::size_t cell = start_;
+        for( std::size_t length = 0; length < obstacles_.size(); ++length )
+        {
+            shortestPath_.push_back( cellPos( cell ) );
+            if( cell == end_ )
+                return;
+
+            std::size_t next = cell;
+            double best = infinity();
+            forEachNeighbour( cell, [&]( std::size_t neighbour ){
+                if( 1 + g_[neighbour] < best )
+                {
+                    best = 1 + g_[neighbour];
+                    next = neighbour;
+                }
+            });
+
+            cell = next;
+        }
+
+        shortestPath_.clear();
+    }
+
+    // A set node holds its value and three links and a colour, rounded up
+    std::size_t bytes()const
+    {
+        return obstacles_.capacity() / 8 + isOpen_.capacity() / 8
+               + ( g_.capacity() + rhs_.capacity() ) * sizeof(double)
+               + openKey_.capacity() * sizeof(Key)
+               + openSet_.size() * ( sizeof(std::pair<Key, std::size_t>) + 4 * sizeof(void*) )
+               + shortestPath_.capacity() * sizeof(GridPos);
+    }
+
+    // One iteration of the search, nextIteration() keeps its statistics
+    bool step( bool debugInfo )
+    {
+        lastAdditionToClose = {};
+        lastAdditionsToOpen.clear();
+
+        if( finished_ )
+            return true;
+
+        // The search stops when no cell in the open set can improve the start
+        if( openSet_.empty()
+            ||  ( !( openSet_.begin()->first < calculateKey( start_ ) )  &&  rhs_[start_] <= g_[start_] ) )
+        {
+            const auto start = SearchStatistics::now();
+            buildShortestPath();
+            statistics_.addTime( statistics_.pathMs, start );
+
+            finished_ = true;
+            return true;
+        }
+
+        const Key oldKey = openSet_.begin()->first;
+        const std::size_t current = openSet_.begin()->second;
+        const Key newKey = calculateKey( current );
+        statistics_.heuristicCall( 2 );
+
+        if( debugInfo )
+        {
+            std::cerr << "Current pos: (" << current / N_ << ',' << current % N_ << ")\n";
+            std::cerr << "g: " << g_[current] << ", rhs: " << rhs_[current]
+                      << ", key: [" << newKey.first << ", " << newKey.second << "]\n";
+        }
+
+        // A key that is out of date is updated before the cell is expanded
+        if( oldKey < newKey )
+        {
+            updateCell( current );
+            return false;
+        }
+
+        removeFromOpen( current );
+        lastAdditionToClose = cellPos( current );
+        statistics_.expanded();
+
+        if( g_[current] > rhs_[current] )
+        {
+            // The cell is overconsistent: its cost goes down, and so can the ones of its neighbours
+            g_[current] = rhs_[current];
+            if( !obstacles_[current] )
+                forEachNeighbour( current, [&]( std::size_t neighbour ){
+                    if( neighbour != end_  &&  1 + g_[current] < rhs_[neighbour] )
+                    {
+                        rhs_[neighbour] = 1 + g_[current];
+                        updateCell( neighbour );
+                    }
+                    else
+                        statistics_.duplicate();
+                });
+        }
+        else
+        {
+            // The cell is underconsistent: its cost went up, so the neighbours that used it are recomputed
+            const double oldG = g_[current];
+            g_[current] = infinity();
+            statistics_.reopenedNode();
+
+            rhs_[current] = lookahead( current );
+            updateCell( current );
+
+            if( !obstacles_[current] )
+                forEachNeighbour( current, [&]( std::size_t neighbour ){
+                    if( neighbour != end_  &&  rhs_[neighbour] == 1 + oldG )
+                    {
+                        rhs_[neighbour] = lookahead( neighbour );
+                        updateCell( neighbour );
+                    }
+                });
+        }
+
+        return false;
+    }
+
+  public:
+    // The obstacles are copied, the shared map is not modified by changeObstacle
+    DStarLite(
+        const OccupancyGrid& obstacles,
+        unsigned startX, unsigned startY,
+        unsigned endX, unsigned endY,
+        unsigned h
+    ):
+      M_( obstacles.numRows() ), N_( obstacles.numCols() ),
+      obstacles_( (std::size_t)M_ * N_ ),
+      h_( (h < NUMBER_OF_HEURISTIC_FUNCTIONS) ? h : 0 ),
+      finished_( false ),
+      start_( (std::size_t)startX * N_ + startY ),
+      end_( (std::size_t)endX * N_ + endY ),
+      g_( obstacles_.size(), infinity() ),
+      rhs_( obstacles_.size(), infinity() ),
+      openKey_( obstacles_.size() ),
+      isOpen_( obstacles_.size(), false )
+    {
+        for( unsigned x = 0; x < M_; ++x )
+            for( unsigned y = 0; y < N_; ++y )
+                obstacles_[ (std::size_t)x * N_ + y ] = obstacles.isObstacle( x, y );
+
+        rhs_[end_] = 0;
+        updateCell( end_ );
+        lastAdditionsToOpen.clear();
+        finishSetup();
+    }
+
+    const std::vector<GridPos>& getShortestPath()const override{ return shortestPath_; }
+
+    bool changeObstacle( unsigned x, unsigned y, bool isObstacle )override
+    {
+        if( x >= M_  ||  y >= N_ )
+            throw std::out_of_range( "Obstacle position outside the map." );
+
+        const std::size_t cell = (std::size_t)x * N_ + y;
+        if( obstacles_[cell] == isObstacle )
+            return true;
+
+        obstacles_[cell] = isObstacle;
+
+        // The costs of the edges of the cell have changed, so its lookahead and the
+        // ones of its neighbours are recomputed. The open set repairs the rest
+        rhs_[cell] = lookahead( cell );
+        updateCell( cell );
+
+        const int cellX = x
+                , cellY = y;
+        for( const GridOffset& offset : Node::NEIGHBOURS )
+        {
+            const int posX = cellX + offset.x
+                    , posY = cellY + offset.y;
+
+            if( posX < 0  ||  posX >= (int)M_  ||  posY < 0  ||  posY >= (int)N_ )
+                continue;
+
+            const std::size_t neighbour = (std::size_t)posX * N_ + posY;
+            rhs_[neighbour] = lookahead( neighbour );
+            updateCell( neighbour );
+        }
+
+        finished_ = false;
+        shortestPath_.clear();
+        return true;
+    }
+
+    // The statistics add up over the replannings, so they show what each change
+    // of the map cost
+    bool nextIteration( bool debugInfo = true )override
+    {
+        statistics_.iterationStarted();
+        const bool finished = step( debugInfo );
+
+        if( finished )
+        {
+            statistics_.searchFinished();
+            statistics_.memory( bytes() );
+        }
+        return finished;
+    }
+};
+
+#endif // DSTAR_LITE_HPP
@@ -0,0 +1,161 @@
+#ifndef GRID_MAP_HPP
+#define GRID_MAP_HPP
+
+#include <memory>
+#include <vector>
+
+#include "Node.hpp"
+#include "OccupancyGrid.hpp"
+
+// Order in which the cells of a GridMap, and the per cell arrays of the searches
+// that use it, are kept in memory.
+//
+// ROW_MAJOR_LAYOUT keeps each row after the previous one, so the vertical
+// neighbours of a cell are a whole row apart. Z_ORDER_LAYOUT splits the map in
+// square tiles, keeps each tile in Z-order (Morton order) and the tiles by rows,
+// so the cells close in the map, in any direction, are close in memory. It helps
+// on big maps, where a row does not fit in the cache.
+enum CellLayout { ROW_MAJOR_LAYOUT, Z_ORDER_LAYOUT };
+
+// Map of the search, built once from the obstacles and shared read only by the
+// searches. Its cells have a border one cell wide around them, made of
+// obstacles, so the neighbours of any cell of the map can be read without bounds
+// checks.
+//
+// The index of a cell depends on the layout. It is always the sum of a value for
+// its row and one for its column, so index() is two lookups in small tables
+// whatever the layout is. The indexes have 64 bits, so maps of more than 2^32
+// cells can be indexed.
+//
+// For each cell it keeps a mask of its free neighbours: bit i is set when the
+// neighbour Node::NEIGHBOURS[i] is inside the map and is not an obstacle. The
+// obstacles themselves are the shared OccupancyGrid it was built from.
+class GridMap
+{
+  public:
+    // Side of the tiles of Z_ORDER_LAYOUT is 2^TILE_BITS cells
+    enum { TILE_BITS = 5, TILE_SIDE = 1 << TILE_BITS, TILE_CELLS = TILE_SIDE * TILE_SIDE };
+
+  private:
+    unsigned M_     // Number of rows
+           , N_;    // Number of columns
+    CellLayout layout_;
+    unsigned width_        // Number of columns with the border
+           , tilesPerRow_; // Only for Z_ORDER_LAYOUT
+    std::shared_ptr<const OccupancyGrid> obstacles_;
+
+    // Part of the index given by the row and by the column, with the border,
+    // so the cell (x, y) is rowOffsets_[x + 1] + columnOffsets_[y + 1]
+    std::vector<std::size_t> rowOffsets_
+                           , columnOffsets_;
+    std::vector<unsigned char> freeNeighbours_;  // Mask of free neighbours of each cell
+
+    // Moves the bits of value to the even positions: abc -> a0b0c
+    static unsigned spreadBits( unsigned value )
+    {
+        unsigned result = 0;
+        for( unsigned bit = 0; bit < TILE_BITS; ++bit )
+            result |= ( ( value >> bit ) & 1 ) << ( 2 * bit );
+        return result;
+    }
+
+    // Inverse of spreadBits, the odd bits are ignored
+    static unsigned compactBits( unsigned value )
+    {
+        unsigned result = 0;
+        for( unsigned bit = 0; bit < TILE_BITS; ++bit )
+            result |= ( ( value >> ( 2 * bit ) ) & 1 ) << bit;
+        return result;
+    }
+
+  public:
+    GridMap( std::shared_ptr<const OccupancyGrid> obstacles, CellLayout layout = ROW_MAJOR_LAYOUT ):
+      M_( obstacles->numRows() ),
+      N_( obstacles->numCols() ),
+      layout_( layout ),
+      width_( N_ + 2 ),
+      tilesPerRow_( ( width_ + TILE_SIDE - 1 ) / TILE_SIDE ),
+      obstacles_( obstacles ),
+      rowOffsets_( M_ + 2 ),
+      columnOffsets_( N_ + 2 )
+    {
+        for( unsigned x = 0; x < M_ + 2; ++x )
+            rowOffsets_[x] = ( layout_ == ROW_MAJOR_LAYOUT )
+                ? (std::size_t)x * width_
+                : (std::size_t)( x / TILE_SIDE ) * tilesPerRow_ * TILE_CELLS + ( spreadBits( x % TILE_SIDE ) << 1 );
+
+        for( unsigned y = 0; y < N_ + 2; ++y )
+            columnOffsets_[y] = ( layout_ == ROW_MAJOR_LAYOUT )
+                ? y
+                : (std::size_t)( y / TILE_SIDE ) * TILE_CELLS + spreadBits( y % TILE_SIDE );
+
+        // The tiles are complete, so the last ones can have cells out of the border
+        const unsigned tileRows = ( M_ + 2 + TILE_SIDE - 1 ) / TILE_SIDE;
+        freeNeighbours_.assign( ( layout_ == ROW_MAJOR_LAYOUT ) ? (std::size_t)(M_ + 2) * width_
+                                                                : (std::size_t)tileRows * tilesPerRow_ * TILE_CELLS, 0 );
+
+        // The cells outside the map are never free neighbours
+        for( unsigned x = 0; x < M_; ++x )
+            for( unsigned y = 0; y < N_; ++y )
+            {
+                unsigned char mask = 0;
+
+                for( unsigned i = 0; i < Node::NEIGHBOURS.size(); ++i )
+                    if( obstacles_->isFree( x + Node::NEIGHBOURS[i].x, y + Node::NEIGHBOURS[i].y ) )
+                        mask |= 1 << i;
+
+                freeNeighbours_[ index(x, y) ] = mask;
+            }
+    }
+
+    unsigned numRows()const{ return M_; }
+    unsigned numCols()const{ return N_; }
+    CellLayout layout()const{ return layout_; }
+
+    // Number of cell indexes, counting the border
+    std::size_t size()const{ return freeNeighbours_.size(); }
+
+    // Memory held by the map, without the shared obstacles
+    std::size_t bytes()const
+    {
+        return freeNeighbours_.capacity() + ( rowOffsets_.capacity() + columnOffsets_.capacity() ) * sizeof(std::size_t);
+    }
+
+    // The position can be one cell outside the map, in the border. Unsigned
+    // positions of -1 wrap around to the border too
+    std::size_t index( unsigned x, unsigned y )const{ return rowOffsets_[x + 1] + columnOffsets_[y + 1]; }
+    std::size_t index( const GridPos& pos )const{ return index( pos.x, pos.y ); }
+
+    GridPos pos( std::size_t index )const
+    {
+        if( layout_ == ROW_MAJOR_LAYOUT )
+            return { unsigned( index / width_ ) - 1, unsigned( index % width_ ) - 1 };
+
+        const std::size_t tile = index / TILE_CELLS;
+        const unsigned local = index % TILE_CELLS;
+        return { unsigned( tile / tilesPerRow_ ) * TILE_SIDE + compactBits( local >> 1 ) - 1,
+                 unsigned( tile % tilesPerRow_ ) * TILE_SIDE + compactBits( local ) - 1 };
+    }
+
+    const OccupancyGrid& obstacles()const{ return *obstacles_; }
+
+    unsigned char freeNeighbours( std::size_t index )const{ return freeNeighbours_[index]; }
+};
+
+// Slots of an open set indexed like the cells of a GridMap, so the open set
+// follows the layout of the map too, see PathSlots
+class MapPathSlots : public PathSlots
+{
+  private:
+    std::shared_ptr<const GridMap> map_;
+
+  public:
+    MapPathSlots( std::shared_ptr<const GridMap> map, bool integralCosts ):
+      PathSlots( map->size(), integralCosts ),
+      map_( map )
+    {}
+
+    std::size_t cell( const GridPos& pos )const{ return map_->index( pos ); }
+};
+
+#endif // GRID_MAP_HPP
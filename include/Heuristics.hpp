@@ -0,0 +1,77 @@
+#ifndef HEURISTICS_HPP
+#define HEURISTICS_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+// Heuristic functions of the search, in the same order as their number in the
+// problem file. They are functors instead of std::function so the search
+// algorithms can be templated on them and the calls can be inlined.
+// INTEGRAL_VALUES tells whether the heuristic always returns integers, so with
+// unit step costs the f values of the paths are integers too.
+
+struct ZeroHeuristic
+{
+    static constexpr bool INTEGRAL_VALUES = true;
+
+    double operator()( int /*x*/, int /*y*/, int /*endX*/, int /*endY*/ )const{ return 0; }
+};
+
+struct ChebyshevHeuristic
+{
+    static constexpr bool INTEGRAL_VALUES = true;
+
+    double operator()( int x, int y, int endX, int endY )const
+    {
+        return std::max( std::abs(endX - x), std::abs(endY - y) );
+    }
+};
+
+struct ManhattanHeuristic
+{
+    static constexpr bool INTEGRAL_VALUES = true;
+
+    double operator()( int x, int y, int endX, int endY )const
+    {
+        return std::abs(endX - x) + std::abs(endY - y);
+    }
+};
+
+struct EuclideanHeuristic
+{
+    static constexpr bool INTEGRAL_VALUES = false;
+
+    double operator()( int x, int y, int endX, int endY )const
+    {
+        const double dx = endX - x
+                   , dy = endY - y;
+        return std::sqrt( dx * dx + dy * dy );
+    }
+};
+
+// Number of heuristic functions above
+const unsigned NUMBER_OF_HEURISTIC_FUNCTIONS = 4;
+
+// Calls visitor with an instance of the heuristic functor number h, so the
+// caller can choose a template instantiation only once. Unknown numbers
+// use the zero heuristic.
+template<class Visitor>
+auto visitHeuristic( unsigned h, Visitor&& visitor ) -> decltype( visitor( ZeroHeuristic() ) )
+{
+    switch( h )
+    {
+        case 1:  return visitor( ChebyshevHeuristic() );
+        case 2:  return visitor( ManhattanHeuristic() );
+        case 3:  return visitor( EuclideanHeuristic() );
+        default: return visitor( ZeroHeuristic() );
+    }
+}
+
+// Returns whether the heuristic number h always returns integers
+inline bool hasIntegralValues( unsigned h )
+{
+    return visitHeuristic( h, []( auto heuristic ){ return decltype(heuristic)::INTEGRAL_VALUES; } );
+}
+
+#endif // HEURISTICS_HPP
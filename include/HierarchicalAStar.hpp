@@ -0,0 +1,169 @@
+#ifndef HIERARCHICAL_ASTAR_HPP
+#define HIERARCHICAL_ASTAR_HPP
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+#include "Node.hpp"
+#include "OccupancyGrid.hpp"
+#include "ShortestPathAlgorithm.hpp"
+
+// Abstract graph of a map for hierarchical path finding (HPA*). The map is split
+// in square clusters. Where two neighbour clusters have free cells at both sides
+// of their border there are entrances, and the cells of each entrance are the
+// nodes of the graph. Nodes of neighbour clusters are joined with edges of cost
+// 1, and nodes of the same cluster with the length of the shortest path between
+// them inside the cluster.
+//
+// The graph only depends on the map, so it is built once and can be saved to a
+// file and loaded by later runs. Its size depends on the number of entrances and
+// not on the number of cells, so with a mapped OccupancyGrid the maps bigger
+// than the memory can be searched: a query only reads the clusters of its ends
+// and of its path.
+class AbstractGraph
+{
+  public:
+    struct Edge
+    {
+        int to;       // Node at the other end
+        int cost;
+    };
+
+    static const unsigned DEFAULT_CLUSTER_SIZE = 16;
+
+  private:
+    unsigned M_  // Number of rows
+           , N_  // Number of columns
+           , clusterSize_;
+    std::uint64_t obstaclesHash_;
+    std::vector<std::size_t> nodeCells_;         // Cell (x * N + y) of each node
+    std::vector<std::vector<Edge>> edges_;       // Edges of each node
+    std::unordered_map<std::size_t, int> cellNodes_; // Node of each cell that is a node
+    std::vector<std::vector<int>> clusterNodes_; // Nodes inside each cluster
+
+    AbstractGraph( unsigned M, unsigned N, unsigned clusterSize, std::uint64_t obstaclesHash );
+
+    int addNode( std::size_t cell );
+    void addEntrances( const OccupancyGrid& obstacles );
+    void addIntraClusterEdges( const OccupancyGrid& obstacles );
+    void indexNodes();
+
+  public:
+    // Builds the graph of the map
+    AbstractGraph( const OccupancyGrid& obstacles, unsigned clusterSize = DEFAULT_CLUSTER_SIZE );
+
+    // Loads the graph from fileName if it was saved for the same map and cluster
+    // size. Otherwise it is built and saved to fileName.
+    static std::shared_ptr<const AbstractGraph> loadOrBuild(
+        const std::string& fileName,
+        const OccupancyGrid& obstacles,
+        unsigned clusterSize = DEFAULT_CLUSTER_SIZE
+    );
+
+    // Returns whether the graph could be written
+    bool save( const std::string& fileName )const;
+
+    unsigned numRows()const{ return M_; }
+    unsigned numCols()const{ return N_; }
+    unsigned clusterSize()const{ return clusterSize_; }
+    std::size_t numNodes()const{ return nodeCells_.size(); }
+
+    std::size_t nodeCell( int node )const{ return nodeCells_[node]; }
+    const std::vector<Edge>& edges( int node )const{ return edges_[node]; }
+
+    // Node of the cell, or -1 if it is not a node
+    int cellNode( std::size_t cell )const
+    {
+        const auto it = cellNodes_.find( cell );
+        return ( it == cellNodes_.end() ) ? -1 : it->second;
+    }
+
+    // Cluster that contains the cell, and nodes inside a cluster
+    std::size_t clusterOf( std::size_t cell )const;
+    const std::vector<int>& clusterNodes( std::size_t cluster )const{ return clusterNodes_[cluster]; }
+
+    // Position of the cell inside its cluster, from 0 to clusterSize^2 - 1
+    unsigned localIndex( std::size_t cell )const;
+
+    // Breadth first search from cell that does not leave its cluster. distances is
+    // filled with the distance to each cell of the cluster, indexed by localIndex,
+    // and -1 for the unreachable ones. If parents is not null it is filled with the
+    // cell (x * N + y) from which each reached cell was reached.
+    void clusterSearch( const OccupancyGrid& obstacles, std::size_t cell,
+                        std::vector<int>& distances, std::vector<std::size_t>* parents = nullptr )const;
+
+    // Hash of the obstacles, to know whether a saved graph belongs to a map
+    static std::uint64_t hashObstacles( const OccupancyGrid& obstacles );
+};
+
+
+// Search on the abstract graph of a map. The start and goal are joined to the
+// nodes of their clusters, each iteration expands one node of the abstract
+// graph, and once the goal is reached the abstract path is refined into cells
+// with searches inside each cluster. The cost of a query depends on the length
+// of the path and not on the size of the map, but the paths are not always the
+// shortest ones: they can be a bit longer because they must go through the
+// entrances of the clusters.
+class HierarchicalAStar : public ShortestPathAlgorithm
+{
+  private:
+    enum { NO_PARENT = -1 };
+
+    struct NodeState
+    {
+        double g;
+        int parent;
+        bool closed;
+    };
+
+    std::shared_ptr<const AbstractGraph> graph_;
+    std::shared_ptr<const OccupancyGrid> obstacles_;
+    int h_;  // Number of the heuristic function, see Heuristics.hpp
+    bool finished_;
+    GridPos start_
+          , end_;
+
+    // The abstract nodes are numbered like in the graph. When the start or the goal
+    // are not nodes of the graph they are added after them, with their own edges.
+    // The state of the search is kept in a hash map, so a query does not cost
+    // anything proportional to the size of the map.
+    int startNode_
+      , endNode_;
+    std::vector<AbstractGraph::Edge> startEdges_; // From the start to the nodes of its cluster
+    std::vector<AbstractGraph::Edge> endEdges_;   // From the nodes of the goal cluster to the goal (to is the origin)
+    // Binary heap of (f, -g, node), so ties in f go to the nodes closer to the goal.
+    // Nodes can be repeated, the entries of closed nodes are skipped
+    using OpenEntry = std::tuple<double, double, int>;
+    std::vector<OpenEntry> openSet_;
+    std::unordered_map<int, NodeState> nodes_;
+    std::vector<GridPos> shortestPath_;
+
+    bool isTemporary( int node )const{ return node >= (int)graph_->numNodes(); }
+    std::size_t nodeCell( int node )const;
+    GridPos nodePos( int node )const;
+    double heuristic( int node )const;
+    void relax( int from, int to, double cost );
+    void buildShortestPath();
+
+    // One iteration of the search, nextIteration() keeps its statistics
+    bool step( bool debugInfo );
+
+  public:
+    HierarchicalAStar(
+        std::shared_ptr<const AbstractGraph> graph,
+        std::shared_ptr<const OccupancyGrid> obstacles,
+        unsigned startX, unsigned startY,
+        unsigned endX, unsigned endY,
+        unsigned h
+    );
+
+    const std::vector<GridPos>& getShortestPath()const override{ return shortestPath_; }
+
+    bool nextIteration( bool debugInfo = true )override;
+};
+
+#endif // HIERARCHICAL_ASTAR_HPP
@@ -0,0 +1,350 @@
+#ifndef JUMP_POINT_SEARCH_HPP
+#define JUMP_POINT_SEARCH_HPP
+
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+
+#include "Heuristics.hpp"
+#include "Node.hpp"
+#include "OccupancyGrid.hpp"
+#include "ShortestPathAlgorithm.hpp"
+
+// Jump Point Search for grids with 4 neighbours and uniform cost. Instead of
+// adding every neighbour to the open set, it jumps in straight lines and only
+// adds the cells where an optimal path may have to turn (jump points), so far
+// less cells are expanded in open areas. The paths have the same length as
+// the ones found by AStar.
+//
+// It only considers the shortest paths that make their horizontal moves (the
+// ones that change y) as soon as possible. So, moving vertically, a path only
+// turns when a horizontal neighbour could not be reached from the previous
+// cell (it is forced). Moving horizontally, it can turn at any cell.
+class JumpPointSearch : public ShortestPathAlgorithm
+{
+  private:
+    unsigned M_  // Number of rows
+           , N_; // Number of columns
+    PathSet openSet_;
+    std::shared_ptr<const OccupancyGrid> obstacles_; // Shared with the other searches of the map
+    int h_;  // Number of the heuristic function, see Heuristics.hpp
+    bool finished_;
+    Path startNode_
+       , endNode_;
+    std::vector<std::int64_t> parent_; // Index (x * N + y) of the jump point from which each
+                                       // jump point was reached, or -1 if it has none
+
+    // State of each cell in the search, indexed x * N + y
+    enum CellState : unsigned char { UNVISITED, OPEN, CLOSED };
+    std::vector<unsigned char> state_;
+    std::vector<double> bestG_; // Cost of the best path found to each jump point
+
+    // Directions in which each jump point has been reached with its best cost, as
+    // bits of the Node::NEIGHBOURS positions. A jump point can be reached with the
+    // same cost from different directions, and each one has its own successors
+    std::vector<unsigned char> arrivals_;
+    std::vector<GridPos> shortestPath_;
+
+    enum { NO_PARENT = -1 };
+
+    // Instantiation of expandSuccessors for the heuristic h_, chosen once at construction
+    void (JumpPointSearch::*expandSuccessors_)( const Path& current );
+
+  private:
+    std::size_t cellIndex( const GridPos& pos )const{ return (std::size_t)pos.x * N_ + pos.y; }
+
+    // The cells outside the map are not free, so a jump stops at the border
+    bool isFree( int x, int y )const
+    {
+        return obstacles_->isFree( x, y );
+    }
+
+    static unsigned char directionBit( int dx, int dy )
+    {
+        for( unsigned i = 0; i < Node::NEIGHBOURS.size(); ++i )
+            if( Node::NEIGHBOURS[i].x == dx  &&  Node::NEIGHBOURS[i].y == dy )
+                return 1 << i;
+        return 0;
+    }
+
+    bool isGoal( int x, int y )const
+    {
+        return( x == (int)endNode_.pos().x  &&  y == (int)endNode_.pos().y );
+    }
+
+    // A cell reached moving vertically has a forced neighbour when one of its
+    // horizontal neighbours is free but the same neighbour of the previous cell is not
+    bool hasForcedNeighbour( int x, int y, int dx )const
+    {
+        return( ( isFree(x, y - 1)  &&  !isFree(x - dx, y - 1) )
+            ||  ( isFree(x, y + 1)  &&  !isFree(x - dx, y + 1) ) );
+    }
+
+    // Moves from (x, y) in the vertical direction dx until it finds the goal or a
+    // cell with a forced neighbour. Returns whether a jump point was found, in that case x is its row
+    bool jumpVertical( int& x, int y, int dx )const
+    {
+        while( true )
+        {
+            x += dx;
+
+            if( !isFree(x, y) )
+                return false;
+
+            if( isGoal(x, y)  ||  hasForcedNeighbour(x, y, dx) )
+                return true;
+        }
+    }
+
+    // Moves from (x, y) in the horizontal direction dy until it finds the goal or a
+    // cell from which a vertical jump finds a jump point. Returns whether a jump point
+    // was found, in that case y is its column
+    bool jumpHorizontal( int x, int& y, int dy )const
+    {
+        // The jump ends at the first obstacle of the row, which is found reading
+        // the row a word at a time
+        const int stop = ( dy > 0 ) ? (int)obstacles_->nextObstacle( x, y + 1 )
+                                    : obstacles_->previousObstacle( x, y - 1 );
+
+        for( y += dy;  y != stop;  y += dy )
+        {
+            int up = x
+              , down = x;
+            if( isGoal(x, y)  ||  jumpVertical(up, y, -1)  ||  jumpVertical(down, y, +1) )
+                return true;
+        }
+        return false;
+    }
+
+    // Walks the jump points back from the goal, filling the straight segments between them
+    void buildShortestPath()
+    {
+        const auto start = SearchStatistics::now();
+        shortestPath_.clear();
+
+        std::int64_t cell = cellIndex( endNode_.pos() );
+        while( parent_[cell] != NO_PARENT )
+        {
+            const std::int64_t parent = parent_[cell]
+                             , step = ( parent > cell ) ? ( parent - cell < N_ ? 1 : N_ )
+                                                        : ( cell - parent < N_ ? -1 : -(std::int64_t)N_ );
+
+            for( ; cell != parent; cell += step )
+                shortestPath_.push_back( {unsigned( cell / N_ ), unsigned( cell % N_ )} );
+        }
+        shortestPath_.push_back( {unsigned( cell / N_ ), unsigned( cell % N_ )} );
+
+        std::reverse( shortestPath_.begin(), shortestPath_.end() );
+        statistics_.addTime( statistics_.pathMs, start );
+    }
+
+    // Adds the jump point found from current in the direction (dx, dy), if any, to the open set
+    template<class Heuristic>
+    void addSuccessor( const Path& current, const Heuristic& heuristic, int dx, int dy )
+    {
+        int x = current.pos().x
+          , y = current.pos().y;
+
+        const bool found = ( dx != 0 ) ? jumpVertical( x, y, dx ) : jumpHorizontal( x, y, dy );
+        if( !found )
+            return;
+
+        const std::size_t index = (std::size_t)x * N_ + y;
+        const double distance = std::abs( x - (int)current.pos().x ) + std::abs( y - (int)current.pos().y )
+                   , newG = current.g() + distance;
+
+        const unsigned char direction = directionBit( dx, dy );
+
+        Path newPath = current;
+        newPath.update(
+            {(unsigned)x, (unsigned)y},
+            distance, heuristic( x, y, endNode_.pos().x, endNode_.pos().y )
+        );
+        statistics_.heuristicCall();
+
+        if( state_[ index ] != UNVISITED )
+        {
+            // If we already have a better path to this jump point we do nothing with it
+            if( bestG_[ index ] < newG  ||  ( bestG_[ index ] == newG  &&  ( arrivals_[ index ] & direction ) ) )
+            {
+                statistics_.duplicate();
+                return;
+            }
+
+            // With the same cost, the jump point also has to be expanded in this
+            // direction. If it was already closed we open it again
+            if( bestG_[ index ] == newG )
+            {
+                arrivals_[ index ] |= direction;
+                if( state_[ index ] == CLOSED )
+                {
+                    openSet_.insert( newPath );
+                    state_[ index ] = OPEN;
+                    lastAdditionsToOpen.push_back( newPath.pos() );
+                    statistics_.reopenedNode();
+                    statistics_.generated();
+                }
+                return;
+            }
+        }
+
+        if( state_[ index ] == CLOSED )
+            statistics_.reopenedNode();
+        statistics_.generated();
+
+        openSet_.insertAndKeepMinimum( newPath );
+        state_[ index ] = OPEN;
+        bestG_[ index ] = newG;
+        arrivals_[ index ] = direction;
+        parent_[ index ] = cellIndex( current.pos() );
+        lastAdditionsToOpen.push_back( newPath.pos() );
+    }
+
+    // Adds the jump points reachable from current to the open set. The directions
+    // to search depend on the directions in which current was reached
+    template<class Heuristic>
+    void expandSuccessors( const Path& current )
+    {
+        const Heuristic heuristic;
+        const GridPos pos = current.pos();
+        const unsigned char arrivals = arrivals_[ cellIndex(pos) ];
+
+        for( unsigned i = 0; i < Node::NEIGHBOURS.size(); ++i )
+        {
+            const int dx = Node::NEIGHBOURS[i].x
+                    , dy = Node::NEIGHBOURS[i].y;
+
+            // The start was not reached from anywhere, so every direction is searched
+            if( arrivals == 0 )
+            {
+                addSuccessor( current, heuristic, dx, dy );
+                continue;
+            }
+
+            if( !( arrivals & (1 << i) ) )
+                continue;
+
+            if( dx != 0 )
+            {
+                // Reached moving vertically: keep moving and turn to the forced neighbours
+                addSuccessor( current, heuristic, dx, 0 );
+                for( int side : { -1, +1 } )
+                    if( isFree(pos.x, pos.y + side)  &&  !isFree(pos.x - dx, pos.y + side) )
+                        addSuccessor( current, heuristic, 0, side );
+            }
+            else
+            {
+                // Reached moving horizontally: keep moving or turn to any vertical direction
+                addSuccessor( current, heuristic, 0, dy );
+                addSuccessor( current, heuristic, -1, 0 );
+                addSuccessor( current, heuristic, +1, 0 );
+            }
+        }
+    }
+
+  public:
+    JumpPointSearch(
+        std::shared_ptr<const OccupancyGrid> obstacles,
+        unsigned startX, unsigned startY,
+        unsigned endX, unsigned endY,
+        unsigned h
+    ):
+      M_( obstacles->numRows() ), N_( obstacles->numCols() ),
+      openSet_( M_, N_, hasIntegralValues( h ) ), // Bucket queue when the f values are integers
+      obstacles_( obstacles ),
+      h_( (h < NUMBER_OF_HEURISTIC_FUNCTIONS) ? h : 0 ),
+      finished_( false ),
+      startNode_(),
+      endNode_(),
+      parent_( (std::size_t)M_ * N_, NO_PARENT ),
+      state_( (std::size_t)M_ * N_, UNVISITED ),
+      bestG_( (std::size_t)M_ * N_, std::numeric_limits<double>::infinity() ),
+      arrivals_( (std::size_t)M_ * N_, 0 )
+    {
+        expandSuccessors_ = visitHeuristic( h_, []( auto heuristic ){
+            return &JumpPointSearch::expandSuccessors< decltype(heuristic) >;
+        });
+
+        startNode_.update(
+            {startX, startY},
+            0,
+            visitHeuristic( h_, [&]( auto heuristic ){ return heuristic( startX, startY, endX, endY ); } )
+        );
+        endNode_.update( {endX, endY}, 0, 0 );
+
+        openSet_.insert( startNode_ );
+        state_[ cellIndex( startNode_.pos() ) ] = OPEN;
+        bestG_[ cellIndex( startNode_.pos() ) ] = 0;
+        statistics_.generated();
+        statistics_.heuristicCall();
+        statistics_.openSize( 1 );
+        finishSetup();
+    }
+
+    const std::vector<GridPos>& getShortestPath()const override{ return shortestPath_; }
+
+    bool nextIteration( bool debugInfo = true )override
+    {
+        statistics_.iterationStarted();
+        const bool finished = step( debugInfo );
+
+        if( finished )
+        {
+            statistics_.searchFinished();
+            statistics_.memory( openSet_.bytes() + shortestPath_.capacity() * sizeof(GridPos)
+                                + parent_.capacity() * sizeof(std::int64_t) + state_.capacity()
+                                + bestG_.capacity() * sizeof(double) + arrivals_.capacity() );
+        }
+        return finished;
+    }
+
+  private:
+    // One iteration of the search, nextIteration() keeps its statistics
+    bool step( bool debugInfo )
+    {
+        lastAdditionToClose = {};
+        lastAdditionsToOpen.clear();
+
+        if( finished_ )
+            return true;
+
+        // Check if the open set has no elements -> no solution
+        if( openSet_.empty() )
+        {
+            finished_ = true;
+            return true;
+        }
+
+        // Get jump point with lowest f value
+        Path current = openSet_.getLowest();
+
+        if( debugInfo )
+        {
+            std::cerr << "Current jump point: (" << current.pos().x << ',' << current.pos().y << ")\n";
+            std::cerr << "Cost: " << current.g() << ", h: " << current.h() << ", f: " << current.f() << '\n';
+        }
+
+        // Check if current node is the goal -> finished with solution
+        if( current == endNode_ )
+        {
+            buildShortestPath();
+            finished_ = true;
+            return true;
+        }
+
+        openSet_.remove( current );
+        state_[ cellIndex( current.pos() ) ] = CLOSED;
+        lastAdditionToClose = current.pos();
+        statistics_.expanded();
+
+        (this->*expandSuccessors_)( current );
+        statistics_.openSize( openSet_.size() );
+
+        return false;
+    }
+};
+
+#endif // JUMP_POINT_SEARCH_HPP
@@ -0,0 +1,38 @@
+#ifndef MAPPED_FILE_HPP
+#define MAPPED_FILE_HPP
+
+#include <cstddef>
+#include <string>
+
+// File mapped read only in memory. Its pages are read by the system the first
+// time they are used, so mapping a file costs the same whatever its size is,
+// and a file bigger than the memory can be used: the pages not used for a
+// while are dropped and read again when they are needed.
+class MappedFile
+{
+  public:
+    // How the file is going to be read, so the system reads ahead or not
+    enum AccessPattern { SEQUENTIAL_ACCESS, RANDOM_ACCESS };
+
+  private:
+    std::string fileName_;
+    const char* data_;   // nullptr for an empty file, that can not be mapped
+    std::size_t size_;
+
+  public:
+    // Throws std::invalid_argument if the file can not be mapped
+    explicit MappedFile( const std::string& fileName, AccessPattern access = SEQUENTIAL_ACCESS );
+    ~MappedFile();
+
+    MappedFile( const MappedFile& ) = delete;
+    MappedFile& operator= ( const MappedFile& ) = delete;
+
+    // Tells the system how the file is going to be read from now on
+    void advise( AccessPattern access )const;
+
+    const std::string& fileName()const{ return fileName_; }
+    const char* data()const{ return data_; }
+    std::size_t size()const{ return size_; }
+};
+
+#endif // MAPPED_FILE_HPP
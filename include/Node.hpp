@@ -1,9 +1,24 @@
 #ifndef NODE_HPP
 #define NODE_HPP
 
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
 #include <vector>
 
-using Matrix2i = std::vector<sf::Vector2i>;
+// Position of a cell in the grid and offset between two cells. We don't use the
+// SFML vectors here so the search can be built and run without SFML
+struct GridPos
+{
+    unsigned x, y;
+};
+
+struct GridOffset
+{
+    int x, y;
+};
+
+using Matrix2i = std::vector<GridOffset>;
 
 class Node
 {
@@ -14,39 +29,46 @@ class Node
     static const Matrix2i NEIGHBOURS;
 
   public:
+    Node():
+      Node( 0, 0 )
+    {}
+
     Node( unsigned x, unsigned y ):
       x_( x ),
       y_( y )
     {}
       
-    Node( sf::Vector2u pos ):
+    Node( GridPos pos ):
       Node( pos.x, pos.y ) // Leave the construction to the above constructor
     {}
     
     bool operator==( const Node& that )const{ return( x_ == that.x_  &&  y_ == that.y_ ); }
     
-    sf::Vector2u pos()const{ return {x_, y_}; }
+    GridPos pos()const{ return {x_, y_}; }
 };
 
-// Positions of the neighbour relative to a cell
-const Matrix2i Node::NEIGHBOURS = { {0, -1}, {-1, 0}, {+1, 0}, {0, +1} };
-
 
+// A path is only represented by its last node and its cost. The nodes that
+// lead to it are stored by the search algorithm as predecessors of each cell,
+// so copying a path is cheap and does not depend on its length.
 class Path
 {
   private:
-    std::vector<Node> path_;
+    Node last_;    // Last node of the path
     double g_, h_; // Cost and heuristic values
+    bool empty_;
     
   public:
-      Path(): path_(), g_(0), h_(0) {}
-      Path( const Node& n ): path_(), g_(0), h_(0) { update(n, 0, 0); }
+      Path(): last_(), g_(0), h_(0), empty_(true) {}
+      Path( const Node& n ): last_(), g_(0), h_(0), empty_(true) { update(n, 0, 0); }
       
+      // Extends the path with the node n
       Path* update( const Node& n, double costToAdd, double newHeuristicVal )
       {
-          path_.push_back( n );
+          last_ = n;
           g_ += costToAdd;
           h_ = newHeuristicVal;
+          empty_ = false;
           
           return this;
       }
@@ -55,74 +77,258 @@ class Path
       double g()const{ return g_; }
       double h()const{ return h_; }
       
-      bool empty()const{ return path_.empty(); }
+      bool empty()const{ return empty_; }
       
-      bool operator==( const Path& that )const{ return path_.back() == that.path_.back(); }
+      bool operator==( const Path& that )const{ return last_ == that.last_; }
       bool operator<( const Path& that )const{ return f() < that.f(); }
       
-      sf::Vector2u pos()const{ return path_.back().pos(); }
+      GridPos pos()const{ return last_.pos(); }
+};
 
-      std::vector<sf::Vector2u> getPath()const
-      {
-          std::vector<sf::Vector2u> result;
+// Where an open set keeps, for each cell, the position of the path of the cell
+// in the set, and its f value when the set is a bucket queue. These ones are
+// arrays of their own, indexed x * N + y. A search that already keeps a record
+// per cell can keep them there instead, see SearchWorkspace::OpenSlots. Every
+// slot type has the same members.
+class PathSlots
+{
+  public:
+    enum : std::size_t { NOT_IN_SET = ~std::size_t(0) };
 
-          for( const auto& node : path_ )
-              result.push_back( node.pos() );
-          
-          return result;
-      }
+  private:
+    unsigned N_;                         // Number of columns of the grid, used to build the cell index
+    std::vector<std::size_t> position_;  // Or NOT_IN_SET. It can go past 2^31 on the biggest maps
+    std::vector<long> key_;
+
+  protected:
+    // For the slots with another cell index, of cells in [0, cells)
+    PathSlots( std::size_t cells, bool integralCosts ):
+      N_( 0 ),
+      position_( cells, NOT_IN_SET ),
+      key_( integralCosts ? cells : 0 )
+    {}
+
+  public:
+    PathSlots( unsigned M, unsigned N, bool integralCosts ):
+      N_( N ),
+      position_( (std::size_t)M * N, NOT_IN_SET ),
+      key_( integralCosts ? (std::size_t)M * N : 0 )
+    {}
+
+    std::size_t cell( const GridPos& pos )const{ return (std::size_t)pos.x * N_ + pos.y; }
+
+    // NOT_IN_SET if the path of the cell is not in the set
+    std::size_t position( std::size_t cell )const{ return position_[cell]; }
+    void setPosition( std::size_t cell, std::size_t position ){ position_[cell] = position; }
+    void removePosition( std::size_t cell ){ position_[cell] = NOT_IN_SET; }
+
+    long key( std::size_t cell )const{ return key_[cell]; }
+    void setKey( std::size_t cell, long key ){ key_[cell] = key; }
+
+    std::size_t bytes()const{ return position_.capacity() * sizeof(std::size_t) + key_.capacity() * sizeof(long); }
 };
 
-class PathSet
+// Open set of the search, keyed by the cell index so all lookups are O(1). The
+// index and the position of the path of each cell are kept by Slots, see
+// PathSlots. It has two representations:
+//  - An indexed binary heap ordered by f. Getting the lowest path is O(1) and
+//    inserting, removing or decreasing the cost of a path is O(log n).
+//  - A bucket queue (Dial's algorithm), for searches whose f values are integers.
+//    There is a bucket for each f value, kept in a circular array that covers the
+//    range of f values in the set. Every operation is O(1), and as the lowest f
+//    only grows in a search with a consistent heuristic the lowest bucket is
+//    found moving forward. The paths with the same f are taken in LIFO order.
+template< class Slots >
+class BasicPathSet
 {
   private:
-    std::vector<Path> paths_;
+    enum : std::size_t { NOT_IN_SET = PathSlots::NOT_IN_SET };
+
+    Slots slots_;                  // Position of the path of each cell in paths_ or in its bucket
+    bool useBuckets_;
+
+    // Heap representation
+    std::vector<Path> paths_;      // Binary heap ordered by the f value of the paths
+
+    // Bucket representation
+    std::vector<std::vector<Path>> buckets_; // The paths with f value k are in buckets_[k % buckets_.size()]
+    mutable long lowestKey_;                 // Every path in the set has an f value in
+                                             // [lowestKey_, lowestKey_ + buckets_.size())
+    std::size_t count_;
 
   private:
-    // Returns the position of the element in nodes_. Or -1 if not found
-    int find( const Path& toFind )const
+    std::size_t cellIndex( const Path& p )const{ return slots_.cell( p.pos() ); }
+
+    // Returns the position of the element in paths_ or in its bucket. Or NOT_IN_SET if not found
+    std::size_t find( const Path& toFind )const
+    {
+        return slots_.position( cellIndex(toFind) );
+    }
+
+    static long keyOf( const Path& p ){ return (long)p.f(); }
+
+    std::vector<Path>& bucket( long key ){ return buckets_[ key & ( buckets_.size() - 1 ) ]; }
+    const std::vector<Path>& bucket( long key )const{ return buckets_[ key & ( buckets_.size() - 1 ) ]; }
+
+    // Bucket with the lowest f value. The set must not be empty
+    const std::vector<Path>& lowestBucket()const
+    {
+        while( bucket( lowestKey_ ).empty() )
+            ++lowestKey_;
+        return bucket( lowestKey_ );
+    }
+
+    // Makes room for a path with f value key. If it is outside the range covered
+    // by the buckets, they are resized to a power of two that covers every value
+    // and the paths are moved to their new buckets
+    void makeRoomForKey( long key )
+    {
+        if( count_ == 0 )
+            lowestKey_ = key;
+
+        if( key >= lowestKey_  &&  key - lowestKey_ < (long)buckets_.size() )
+            return;
+
+        std::vector<Path> all;
+        all.reserve( count_ );
+        long lowest = key
+           , highest = key;
+        for( auto& b : buckets_ )
+            for( const Path& p : b )
+            {
+                all.push_back( p );
+                lowest = std::min( lowest, keyOf(p) );
+                highest = std::max( highest, keyOf(p) );
+            }
+
+        std::size_t size = buckets_.size();
+        while( (long)size <= highest - lowest )
+            size *= 2;
+
+        buckets_.assign( size, std::vector<Path>() );
+        lowestKey_ = lowest;
+        for( const Path& p : all )
+        {
+            bucket( keyOf(p) ).push_back( p );
+            slots_.setPosition( cellIndex(p), bucket( keyOf(p) ).size() - 1 );
+        }
+    }
+
+    void swapPaths( std::size_t i, std::size_t j )
+    {
+        std::swap( paths_[i], paths_[j] );
+        slots_.setPosition( cellIndex(paths_[i]), i );
+        slots_.setPosition( cellIndex(paths_[j]), j );
+    }
+
+    // Move the element in position i up until its parent is not worse than it
+    void siftUp( std::size_t i )
+    {
+        while( i > 0 )
+        {
+            std::size_t parent = (i - 1) / 2;
+            if( !(paths_[i] < paths_[parent]) )
+                break;
+
+            swapPaths( i, parent );
+            i = parent;
+        }
+    }
+
+    // Move the element in position i down until none of its children is better than it
+    void siftDown( std::size_t i )
     {
-        int pos = -1;
-        for( int i = 0;  i < paths_.size()  &&  pos == -1;  ++i )
-            if( paths_[i] == toFind )
-                pos = i;
+        const std::size_t size = paths_.size();
+        while( true )
+        {
+            std::size_t left = 2 * i + 1
+                      , right = left + 1
+                      , best = i;
+
+            if( left < size  &&  paths_[left] < paths_[best] )
+                best = left;
+            if( right < size  &&  paths_[right] < paths_[best] )
+                best = right;
 
-        return pos;
+            if( best == i )
+                break;
+
+            swapPaths( i, best );
+            i = best;
+        }
     }
- 
+
   public:
-    PathSet(): paths_(){}
+    // integralCosts tells whether the f values of the paths are always
+    // integers, in that case the bucket queue is used
+    BasicPathSet( const Slots& slots, bool integralCosts ):
+      slots_( slots ),
+      useBuckets_( integralCosts ),
+      paths_(),
+      buckets_( integralCosts ? 64 : 0 ),
+      lowestKey_( 0 ),
+      count_( 0 )
+    {}
 
     bool empty()const
     { 
-        return paths_.empty(); 
+        return size() == 0;
+    }
+
+    std::size_t size()const
+    {
+        return useBuckets_ ? count_ : paths_.size();
+    }
+
+    // Memory held by the set
+    std::size_t bytes()const
+    {
+        std::size_t total = slots_.bytes() + paths_.capacity() * sizeof(Path)
+                          + buckets_.capacity() * sizeof(std::vector<Path>);
+        for( const auto& b : buckets_ )
+            total += b.capacity() * sizeof(Path);
+        return total;
+    }
+
+    // Removes all the paths. It only costs the number of paths in the set
+    // (and the number of buckets)
+    void clear()
+    {
+        for( const auto& p : paths_ )
+            slots_.removePosition( cellIndex(p) );
+        paths_.clear();
+
+        for( auto& b : buckets_ )
+        {
+            for( const auto& p : b )
+                slots_.removePosition( cellIndex(p) );
+            b.clear();
+        }
+        count_ = 0;
     }
     
     bool contains( const Path& toFind )const
     {
-        return( find(toFind) != -1 );
+        return( find(toFind) != NOT_IN_SET );
     }
     
     // Returns the node with the minimum value
     Path getLowest()const
     {
         if( empty() )
-            throw;
+            throw std::out_of_range( "The path set is empty." );
 
-        Path min = paths_[0];
-        for( int i = 1;  i < paths_.size();  ++i )
-            if( paths_[i] < min )
-                min = paths_[i];
-
-        return min;
+        return useBuckets_ ? lowestBucket().back() : paths_[0];
     }
     
     Path get( const Path& toGet )const
     {
-        int index = find( toGet );
+        std::size_t index = find( toGet );
 
-        if( index == -1 )
+        if( index == NOT_IN_SET )
             return Path();
+        else if( useBuckets_ )
+            return bucket( slots_.key( cellIndex(toGet) ) )[index];
         else
             return paths_[index];
     }
@@ -132,37 +338,92 @@ class PathSet
     {
         if( contains(toInsert) )
             return false;
-        
+
+        const std::size_t cell = cellIndex( toInsert );
+
+        if( useBuckets_ )
+        {
+            const long key = keyOf( toInsert );
+            makeRoomForKey( key );
+
+            std::vector<Path>& b = bucket( key );
+            b.push_back( toInsert );
+            slots_.setPosition( cell, b.size() - 1 );
+            slots_.setKey( cell, key );
+            ++count_;
+            return true;
+        }
+
         paths_.push_back( toInsert );
+        slots_.setPosition( cell, paths_.size() - 1 );
+        siftUp( paths_.size() - 1 );
         return true;
     }
 
     void remove( const Path& toErase )
     {
-        for( int i = 0;  i < paths_.size();  ++i )
-            if( paths_[i] == toErase )
+        std::size_t index = find( toErase );
+        if( index == NOT_IN_SET )
+            return;
+
+        const std::size_t cell = cellIndex( toErase );
+
+        if( useBuckets_ )
+        {
+            // Put the last path of the bucket in the hole
+            std::vector<Path>& b = bucket( slots_.key( cell ) );
+            if( index != b.size() - 1 )
             {
-                paths_.erase( paths_.begin() + i );
-                break;
+                b[index] = b.back();
+                slots_.setPosition( cellIndex(b[index]), index );
             }
+
+            b.pop_back();
+            slots_.removePosition( cell );
+            --count_;
+            return;
+        }
+
+        // Put the last element in the hole and restore the heap property
+        std::size_t last = paths_.size() - 1;
+        if( index != last )
+            swapPaths( index, last );
+
+        slots_.removePosition( cellIndex(paths_[last]) );
+        paths_.pop_back();
+
+        if( index != last )
+        {
+            siftUp( index );
+            siftDown( index );
+        }
     }
     
     // Returns whether the element was inserted/updated or not
     bool insertAndKeepMinimum( const Path& p ) 
     {
-        int oldElementPos = find( p );
+        std::size_t oldElementPos = find( p );
         
         // If it is a new element we insert it and return true
-        if( oldElementPos == -1 )
+        if( oldElementPos == NOT_IN_SET )
+            return insert( p );
+
+        // If the path was already in the set and the new one is better, we update
+        // the path. In the heap its cost can only decrease so we only have to move
+        // it up, and in the buckets it moves to the bucket of its new cost
+        if( useBuckets_ )
         {
-            paths_.push_back( p );
-            return true;
+            if( !( p < get(p) ) )
+                return false;
+
+            remove( p );
+            return insert( p );
         }
-        // If the path was already in the set and the new one
-        // is better, we update the path 
+
         if( p < paths_[oldElementPos] )
         {
             paths_[oldElementPos] = p;
+            siftUp( oldElementPos );
             return true;
         }
         // If the old one remains equal we return false
@@ -171,4 +432,14 @@ class PathSet
     
 };
 
-#endif
\ No newline at end of file
+// Open set with arrays of its own for the positions of the paths
+class PathSet : public BasicPathSet<PathSlots>
+{
+  public:
+    // M and N are the number of rows and columns of the grid
+    PathSet( unsigned M, unsigned N, bool integralCosts = false ):
+      BasicPathSet<PathSlots>( PathSlots( M, N, integralCosts ), integralCosts )
+    {}
+};
+
+#endif
@@ -0,0 +1,208 @@
+#ifndef OCCUPANCY_GRID_HPP
+#define OCCUPANCY_GRID_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+#include "MappedFile.hpp"
+
+// Obstacles of a map, one bit per cell. The map is split in tiles of 64 x 64
+// cells, and each row of a tile is a 64 bit word, so a row can be read 64 cells
+// at a time and the cells close in the map, in any direction, are close in
+// memory. The tiles are stored by rows, and the bits of the tiles that are
+// outside the map are set, so the end of a row reads as an obstacle.
+//
+// It is built once by the loader and shared as std::shared_ptr<const OccupancyGrid>
+// by every search that uses the map, so the map is never copied.
+//
+// The words can be kept in memory or read from a mapped file. A mapped grid is
+// read only, and only the tiles that a search reads are paged in, 512 bytes
+// each, so it can be bigger than the memory.
+class OccupancyGrid
+{
+  public:
+    enum { WORD_BITS = 64, TILE_ROWS = 64 };
+
+  private:
+    unsigned M_  // Number of rows
+           , N_  // Number of columns
+           , wordsPerRow_;  // Number of tiles in a row of tiles
+    std::size_t numWords_;
+    std::vector<std::uint64_t> memory_;       // Words of a grid kept in memory
+    std::shared_ptr<const MappedFile> file_;  // File of a mapped grid
+    const std::uint64_t* words_;              // The words of memory_ or of file_
+
+    static unsigned lowestBit( std::uint64_t word ){ return __builtin_ctzll( word ); }
+    static unsigned highestBit( std::uint64_t word ){ return WORD_BITS - 1 - __builtin_clzll( word ); }
+
+    static unsigned tilesOf( unsigned cells ){ return ( cells + WORD_BITS - 1 ) / WORD_BITS; }
+
+    // Bit y % 64 of this word is the cell (x, y)
+    std::size_t wordIndex( unsigned x, unsigned y )const
+    {
+        return ( (std::size_t)( x / TILE_ROWS ) * wordsPerRow_ + y / WORD_BITS ) * TILE_ROWS + x % TILE_ROWS;
+    }
+
+    std::uint64_t wordOf( unsigned x, unsigned y )const{ return words_[ wordIndex( x, y ) ]; }
+
+  public:
+    // An M x N map without obstacles
+    OccupancyGrid( unsigned M, unsigned N ):
+      M_( M ),
+      N_( N ),
+      wordsPerRow_( tilesOf( N ) ),
+      numWords_( (std::size_t)tilesOf( M ) * wordsPerRow_ * TILE_ROWS ),
+      memory_( numWords_, 0 ),
+      words_( memory_.data() )
+    {
+        // Set the bits after the end of each row, and the rows after the last one
+        if( N % WORD_BITS != 0 )
+            for( unsigned x = 0; x < M; ++x )
+                memory_[ wordIndex( x, N ) ] = ~std::uint64_t(0) << ( N % WORD_BITS );
+
+        for( std::size_t x = M; x < (std::size_t)tilesOf( M ) * TILE_ROWS; ++x )
+            for( unsigned y = 0; y < wordsPerRow_ * WORD_BITS; y += WORD_BITS )
+                memory_[ wordIndex( x, y ) ] = ~std::uint64_t(0);
+    }
+
+    // obstacles is indexed x * N + y
+    OccupancyGrid( unsigned M, unsigned N, const std::vector<bool>& obstacles ):
+      OccupancyGrid( M, N )
+    {
+        if( obstacles.size() != (std::size_t)M * N )
+            throw std::invalid_argument( "The obstacles do not match the size of the map." );
+
+        for( unsigned x = 0; x < M; ++x )
+            for( unsigned y = 0; y < N; ++y )
+                if( obstacles[ (std::size_t)x * N + y ] )
+                    setObstacle( x, y, true );
+    }
+
+    // An M x N map whose words(), numWords() of them, are in file from offset on.
+    // offset must be a multiple of 8, and the file must be big enough, otherwise
+    // std::invalid_argument is thrown
+    OccupancyGrid( std::shared_ptr<const MappedFile> file, std::size_t offset, unsigned M, unsigned N ):
+      M_( M ),
+      N_( N ),
+      wordsPerRow_( tilesOf( N ) ),
+      numWords_( (std::size_t)tilesOf( M ) * wordsPerRow_ * TILE_ROWS ),
+      file_( file ),
+      words_( nullptr )
+    {
+        if( offset % sizeof(std::uint64_t) != 0  ||  offset > file->size()
+            ||  ( file->size() - offset ) / sizeof(std::uint64_t) < numWords_ )
+            throw std::invalid_argument( "The file " + file->fileName() + " does not hold a map of this size." );
+
+        // The mapping starts at a page, so the words are aligned
+        words_ = reinterpret_cast<const std::uint64_t*>( file->data() + offset );
+    }
+
+    // A copy is always kept in memory, so it can be changed
+    OccupancyGrid( const OccupancyGrid& that ):
+      M_( that.M_ ),
+      N_( that.N_ ),
+      wordsPerRow_( that.wordsPerRow_ ),
+      numWords_( that.numWords_ ),
+      memory_( that.words_, that.words_ + that.numWords_ ),
+      words_( memory_.data() )
+    {}
+
+    OccupancyGrid& operator= ( const OccupancyGrid& that ){ return *this = OccupancyGrid( that ); }
+    OccupancyGrid( OccupancyGrid&& ) = default;
+    OccupancyGrid& operator= ( OccupancyGrid&& ) = default;
+
+    unsigned numRows()const{ return M_; }
+    unsigned numCols()const{ return N_; }
+    bool isMapped()const{ return file_ != nullptr; }
+
+    // Only used while the map is built, the shared grids are const. A mapped
+    // grid can not be changed, std::logic_error is thrown
+    void setObstacle( unsigned x, unsigned y, bool isObstacle )
+    {
+        if( isMapped() )
+            throw std::logic_error( "A mapped grid can not be changed." );
+
+        const std::uint64_t bit = std::uint64_t(1) << ( y % WORD_BITS );
+        if( isObstacle )
+            memory_[ wordIndex( x, y ) ] |= bit;
+        else
+            memory_[ wordIndex( x, y ) ] &= ~bit;
+    }
+
+    // The cell must be inside the map
+    bool isObstacle( unsigned x, unsigned y )const
+    {
+        return ( wordOf( x, y ) >> ( y % WORD_BITS ) ) & 1;
+    }
+
+    // Any position can be asked, the cells outside the map are not free
+    bool isFree( int x, int y )const
+    {
+        return (unsigned)x < M_  &&  (unsigned)y < N_  &&  !isObstacle( x, y );
+    }
+
+    // The 64 cells of the row x from the column y: bit i is set if (x, y + i)
+    // is an obstacle or is outside the map
+    std::uint64_t rowWord( unsigned x, unsigned y )const
+    {
+        if( y >= N_ )
+            return ~std::uint64_t(0);
+
+        const unsigned shift = y % WORD_BITS;
+        std::uint64_t bits = wordOf( x, y ) >> shift;
+
+        if( shift != 0 )
+            bits |= ( y / WORD_BITS + 1 < wordsPerRow_ ? wordOf( x, y + WORD_BITS ) : ~std::uint64_t(0) )
+                    << ( WORD_BITS - shift );
+
+        return bits;
+    }
+
+    // Column of the first obstacle of the row x at or after the column y, or
+    // N if there is none. It reads the row a word at a time
+    unsigned nextObstacle( unsigned x, unsigned y )const
+    {
+        for( ; y < N_; y += WORD_BITS - y % WORD_BITS )
+        {
+            const std::uint64_t bits = wordOf( x, y ) & ( ~std::uint64_t(0) << ( y % WORD_BITS ) );
+            if( bits != 0 )
+                return std::min( N_, y - y % WORD_BITS + lowestBit( bits ) );
+        }
+        return N_;
+    }
+
+    // Column of the last obstacle of the row x at or before the column y (y < N),
+    // or -1 if there is none. It reads the row a word at a time
+    int previousObstacle( unsigned x, int y )const
+    {
+        for( ; y >= 0; y = y - y % WORD_BITS - 1 )
+        {
+            const unsigned shift = WORD_BITS - 1 - y % WORD_BITS;
+            const std::uint64_t bits = ( wordOf( x, y ) << shift ) >> shift;
+            if( bits != 0 )
+                return y - y % WORD_BITS + highestBit( bits );
+        }
+        return -1;
+    }
+
+    // Number of obstacles in the map
+    std::size_t count()const
+    {
+        std::size_t total = 0;
+        for( std::size_t i = 0; i < numWords_; ++i )
+            total += __builtin_popcountll( words_[i] );
+
+        // The bits outside the map are not obstacles
+        return total - ( numWords_ * WORD_BITS - (std::size_t)M_ * N_ );
+    }
+
+    // The words of the tiles: the tile (i, j) is the words from
+    // ( i * wordsPerRow + j ) * TILE_ROWS on, one for each of its rows
+    const std::uint64_t* words()const{ return words_; }
+    std::size_t numWords()const{ return numWords_; }
+};
+
+#endif // OCCUPANCY_GRID_HPP
@@ -4,31 +4,55 @@
 
 #include <algorithm>
 #include <chrono>
+#include <cstdint>
 #include <fstream>
+#include <istream>
+#include <memory>
 #include <random>
 #include <stdexcept>
 #include <string>
 #include <vector>
 
+#include "OccupancyGrid.hpp"
+
 // struct that defines a position.
 typedef struct {
     unsigned int x;
     unsigned int y;
 } position;
 
+// struct that defines a change of the obstacles after the first search.
+typedef struct {
+    position pos;
+    bool add;   // true if the obstacle is added, false if it is removed.
+} obstacleChange;
+
 // ENumeration of heuristics
 enum heuristicsName {NOT_HEUSRISTIC, HEURISTIC_1, HEURISTIC_2, HEURISTIC_3};
 
 // Number of heuristics to solve the problem.
 const int NUMBER_OF_HEURISTICS = 4;
 
-// Max size of the grid.
-const int MAX_COLUMN = 1000;
-const int MAX_ROW = 1000;
+// Enumeration of the search algorithms, and the names used to choose them
+// in the problem file and in the command line.
+enum algorithmName {A_STAR, JUMP_POINT_SEARCH, BIDIRECTIONAL_A_STAR, HIERARCHICAL_A_STAR, D_STAR_LITE};
+const std::vector<std::string> ALGORITHM_NAMES = {"astar", "jps", "bidirectional", "hpa", "dstar-lite"};
+
+// Returns the algorithm with the given name. Throws std::invalid_argument
+// if there is no algorithm with that name.
+algorithmName algorithmFromName(const std::string &name);
+
+// Returns a random number in [0, bound) drawn from generator. Unlike the
+// standard distributions, it gives the same numbers with every library, so
+// the same seed always builds the same map. bound can not be 0.
+std::uint64_t randomBelow(std::mt19937 &generator, std::uint64_t bound);
 
 // The default path of configuration file.
 const std::string DEFAULT_FILE_PATH = "test/default.txt";
 
+// Reader of the problem files, defined in ProblemSpecification.cpp.
+class problemFileReader;
+
 class problemSpecification {
 
  public:
@@ -40,10 +64,28 @@ class problemSpecification {
   // Destructor of the class.
   ~problemSpecification();
 
+  // Writes the problem to file_name as a binary map. The binary maps are
+  // loaded by the constructor like the text files, but their grid is
+  // mapped from the file instead of read, so they load in the same time
+  // whatever the number of obstacles is. Returns whether it could be written.
+  bool saveBinary(const std::string &file_name) const;
+
   // Returns the heuristic that the user want for the
   // problem.
   heuristicsName heuristic(void)const;
 
+  // Returns the search algorithm that the user want for the problem.
+  algorithmName algorithm(void)const;
+
+  // Returns the file where the precomputation of the map is kept between
+  // runs, or an empty string if it is not kept.
+  std::string cacheFile(void)const;
+
+  // Returns the seed of the random obstacles. It is given by the seed
+  // directive, so the same obstacles are generated in every run, or it
+  // is taken from the clock.
+  std::uint64_t seed(void)const;
+
   // Returns the number of rows that the user want for the grid.
   int rows(void)const;
 
@@ -58,28 +100,41 @@ class problemSpecification {
 
   // Return the number of obstacles that the usar want to add to
   // the problem.
-  int getNumberOfObstaces(void) const;
+  std::size_t getNumberOfObstaces(void) const;
+
+  // Return the obstacles of the grid. They are built once when the file
+  // is read, and the searches share them instead of copying them.
+  std::shared_ptr<const OccupancyGrid> obstacles(void) const;
 
-  // Return the specified i-object that the user want to get.
-  position getObstacle(int i) const;
+  // Return the changes of the obstacles that happen after the first
+  // search, in the order in which they happen.
+  const std::vector<obstacleChange>& obstacleChanges(void) const;
 
  private:
 
   heuristicsName heuristic_;
+  algorithmName algorithm_;
+  std::string cache_file_;
+  std::uint64_t seed_;
+  std::vector<obstacleChange> obstacle_changes_;
   int number_of_colums_;
   int number_of_rows_;
-  int car_position_;
-  int final_position_;
-  std::vector<int> obstacle_positions_;
+  std::int64_t car_position_;   // Positions in vector, x * columns + y.
+  std::int64_t final_position_;
+  std::shared_ptr<OccupancyGrid> obstacles_;
+
+  position matrixPos(const std::int64_t vector_position) const;
+  std::int64_t vectorPos(const position matrix_position) const;
 
-  position matrixPos(const int vector_position) const;
-  int vectorPos(const position matrix_position) const;
+  void generateRandomObstacles(std::int64_t obstacles_to_generate);
 
-  bool variablesAreConfigured(int number_of_obstacles) const;
-  void generateRandomObstacles(int obstacles_to_generate);
+  // Reads a position "x y" and returns it in vector, or -1 if it is
+  // outside the grid.
+  std::int64_t readPosition(problemFileReader &input, const char *what) const;
+  void readDirectives(problemFileReader &input);
+  void loadBinary(std::shared_ptr<const MappedFile> file);
 
-  bool positionIsIntroduced(int to_check_position) const;
-  void eraseIntroducedPositions(std::vector<int> &posible_obstacles) const;
+  bool positionIsIntroduced(std::int64_t to_check_position) const;
 };
 
 #endif //IA_P1_PROBLEMSPECIFICATION_H
@@ -0,0 +1,111 @@
+#ifndef SEARCH_STATISTICS_HPP
+#define SEARCH_STATISTICS_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+
+// The statistics are counted unless the project is built with
+// -DSEARCH_STATISTICS=0. Then every method below is empty, so the searches
+// cost the same as without them.
+#ifndef SEARCH_STATISTICS
+#define SEARCH_STATISTICS 1
+#endif
+
+// Counters and timings of a search. Every search keeps one, see
+// ShortestPathAlgorithm::statistics(), and it can be read during the search or
+// after it. The searches only count what applies to them, the rest stays 0.
+struct SearchStatistics
+{
+    enum { ENABLED = SEARCH_STATISTICS };
+    using Clock = std::chrono::steady_clock;
+
+    std::uint64_t expansions = 0      // Nodes taken from the open set and expanded
+                , generations = 0     // Paths added to the open set, or improved in it
+                , duplicates = 0      // Paths to a node not better than the one it already had
+                , reopened = 0        // Closed nodes opened again with a better path
+                , heuristicCalls = 0;
+    std::size_t closedNodes = 0       // Nodes closed now
+              , peakOpen = 0          // Most nodes in the open set at a time
+              , peakClosed = 0
+              , bytesAllocated = 0;   // Memory of the state of the search when it finished
+    double setupMs = 0    // Time to prepare the search
+         , searchMs = 0   // Time from the first iteration to the one that finished the
+                          // search, building the path included. When the iterations are
+                          // run one at a time with other work between them, as the
+                          // graphical program does, that work is included too
+         , pathMs = 0;    // Time to build the path
+    Clock::time_point searchStart;  // First iteration of the search running now, if any
+
+    void reset(){ *this = SearchStatistics(); }
+
+    // Start of a phase, for addTime
+    static Clock::time_point now(){ return ENABLED ? Clock::now() : Clock::time_point(); }
+
+    // Adds the time since start to a phase
+    void addTime( double& phase, Clock::time_point start )
+    {
+        if( ENABLED )
+            phase += std::chrono::duration<double, std::milli>( Clock::now() - start ).count();
+    }
+
+    // Called at each iteration. Only the first iteration and the last one read the
+    // clock, reading it at each iteration would cost as much as a small expansion
+    void iterationStarted()
+    {
+        if( ENABLED  &&  searchStart == Clock::time_point() )
+            searchStart = Clock::now();
+    }
+
+    void searchFinished()
+    {
+        if( ENABLED )
+        {
+            addTime( searchMs, searchStart );
+            searchStart = Clock::time_point();
+        }
+    }
+
+    void expanded()
+    {
+        if( ENABLED )
+        {
+            ++expansions;
+            peakClosed = std::max( peakClosed, ++closedNodes );
+        }
+    }
+
+    void generated( unsigned paths = 1 ){ if( ENABLED ) generations += paths; }
+    void duplicate(){ if( ENABLED ) ++duplicates; }
+    void heuristicCall( unsigned calls = 1 ){ if( ENABLED ) heuristicCalls += calls; }
+
+    void reopenedNode()
+    {
+        if( ENABLED )
+        {
+            ++reopened;
+            --closedNodes;
+        }
+    }
+
+    void openSize( std::size_t size ){ if( ENABLED ) peakOpen = std::max( peakOpen, size ); }
+    void memory( std::size_t bytes ){ if( ENABLED ) bytesAllocated = bytes; }
+};
+
+inline std::ostream& operator<<( std::ostream& output, const SearchStatistics& statistics )
+{
+    if( !SearchStatistics::ENABLED )
+        return output << "Search statistics disabled (built with SEARCH_STATISTICS=0)\n";
+
+    return output
+        << "Expansions: " << statistics.expansions << ", generations: " << statistics.generations
+        << ", duplicates: " << statistics.duplicates << ", reopened: " << statistics.reopened << '\n'
+        << "Heuristic calls: " << statistics.heuristicCalls << '\n'
+        << "Peak open: " << statistics.peakOpen << ", peak closed: " << statistics.peakClosed << '\n'
+        << "Memory: " << statistics.bytesAllocated << " bytes\n"
+        << "Setup: " << statistics.setupMs << " ms, search: " << statistics.searchMs
+        << " ms, of which building the path: " << statistics.pathMs << " ms\n";
+}
+
+#endif // SEARCH_STATISTICS_HPP
@@ -0,0 +1,184 @@
+#ifndef SEARCH_WORKSPACE_HPP
+#define SEARCH_WORKSPACE_HPP
+
+#include <cstdlib>
+#include <limits>
+#include <memory>
+#include <new>
+
+#include "GridMap.hpp"
+#include "Node.hpp"
+
+// Memory of a search on a map: the open set and the state of each cell. It is
+// kept between searches on the same map, so the searches after the first one do
+// not allocate anything.
+//
+// Each cell keeps the number of the search (epoch) that last wrote it, and the
+// cells written by an older search read as unvisited. So a new search only
+// increases the epoch instead of clearing the arrays, and starting it costs the
+// same on any map size. A workspace can only be used by one search at a time.
+//
+// The epochs are even, and the lowest bit of the stamp of a cell tells whether
+// it is closed. The predecessor of a cell is always one of its neighbours, so it
+// is kept as the move that reaches the cell. The open set keeps the position of
+// the path of each cell in the cell too, so a cell takes 32 bytes and there are
+// no other arrays per cell.
+//
+// A stamp of 0 is never current, so the cells start as zeroed memory and are not
+// written when the workspace is created. The system gives the pages of a big
+// allocation already zeroed the first time they are used, so only the memory of
+// the cells that the searches visit is used.
+class SearchWorkspace
+{
+  public:
+    enum CellState : unsigned char { UNVISITED, OPEN, CLOSED };
+    enum : unsigned char { NO_PARENT = 0xFF };
+
+  private:
+    enum { CLOSED_BIT = 1 };
+
+    // The fields of a cell are read together, so they are kept together
+    struct Cell
+    {
+        double g;                  // Cost of the best path found to the cell
+        std::size_t openPosition;  // Position of the path of the cell in the open set, while it is open
+        long openKey;              // f value of that path, when the open set is a bucket queue
+        unsigned stamp;            // Epoch of the search that wrote the cell, plus CLOSED_BIT if it is closed
+        unsigned char parentMove;  // Position in Node::NEIGHBOURS of the move from the predecessor of
+                                   // the cell in the best path to the cell, or NO_PARENT
+    };
+
+    struct FreeCells
+    {
+        void operator()( Cell* cells )const{ std::free( cells ); }
+    };
+
+    bool isCurrent( std::size_t cell )const{ return ( cells_[cell].stamp & ~CLOSED_BIT ) == epoch_; }
+
+    std::shared_ptr<const GridMap> map_;
+    std::size_t size_;
+    std::unique_ptr<Cell[], FreeCells> cells_;  // Indexed like the cells of the map
+    unsigned epoch_;
+    bool integralCosts_;
+
+  public:
+    // Slots of the open set in the cells, see PathSlots. The path of a cell is
+    // in the set while the cell is open. It leaves the set to be closed, or to
+    // go back with a better path
+    class OpenSlots
+    {
+      private:
+        SearchWorkspace* workspace_;
+
+      public:
+        explicit OpenSlots( SearchWorkspace* workspace ):
+          workspace_( workspace )
+        {}
+
+        std::size_t cell( const GridPos& pos )const{ return workspace_->map_->index( pos ); }
+
+        std::size_t position( std::size_t cell )const
+        {
+            return workspace_->state( cell ) == OPEN ? workspace_->cells_[cell].openPosition
+                                                     : (std::size_t)PathSlots::NOT_IN_SET;
+        }
+
+        // Opens the cell. Its g and predecessor are set by SearchWorkspace::open()
+        void setPosition( std::size_t cell, std::size_t position )
+        {
+            Cell& c = workspace_->cells_[cell];
+            if( !workspace_->isCurrent( cell ) )
+            {
+                c.g = std::numeric_limits<double>::infinity();
+                c.parentMove = NO_PARENT;
+            }
+            c.openPosition = position;
+            c.stamp = workspace_->epoch_;
+        }
+
+        void removePosition( std::size_t cell ){ workspace_->cells_[cell].stamp |= CLOSED_BIT; }
+
+        long key( std::size_t cell )const{ return workspace_->cells_[cell].openKey; }
+        void setKey( std::size_t cell, long key ){ workspace_->cells_[cell].openKey = key; }
+
+        // They are counted in the cells
+        std::size_t bytes()const{ return 0; }
+    };
+
+    BasicPathSet<OpenSlots> openSet;
+
+  public:
+    // integralCosts tells whether the f values of the search are always integers,
+    // see PathSet
+    SearchWorkspace( std::shared_ptr<const GridMap> map, bool integralCosts ):
+      map_( map ),
+      size_( map->size() ),
+      cells_( static_cast<Cell*>( std::calloc( size_, sizeof(Cell) ) ) ),
+      epoch_( 2 ),
+      integralCosts_( integralCosts ),
+      openSet( OpenSlots( this ), integralCosts )
+    {
+        if( !cells_ )
+            throw std::bad_alloc();
+    }
+
+    // The open set points to this workspace
+    SearchWorkspace( const SearchWorkspace& ) = delete;
+    SearchWorkspace& operator= ( const SearchWorkspace& ) = delete;
+
+    std::size_t size()const{ return size_; }
+    std::size_t bytes()const{ return size_ * sizeof(Cell) + openSet.bytes(); }
+    bool hasIntegralCosts()const{ return integralCosts_; }
+
+    // Whether the cells of map have the same indexes as the ones of the map of the workspace
+    bool fits( const GridMap& map )const
+    {
+        return map.numRows() == map_->numRows()  &&  map.numCols() == map_->numCols()  &&  map.layout() == map_->layout();
+    }
+
+    // Forgets the previous search. The open set only costs its remaining paths
+    void reset()
+    {
+        openSet.clear();
+
+        // When the epoch wraps around the old stamps could look current again,
+        // so that time they are cleared
+        epoch_ += 2;
+        if( epoch_ == 0 )
+        {
+            for( std::size_t cell = 0;  cell < size_;  ++cell )
+                cells_[cell].stamp = 0;
+            epoch_ = 2;
+        }
+    }
+
+    CellState state( std::size_t cell )const
+    {
+        if( !isCurrent( cell ) )
+            return UNVISITED;
+        return ( cells_[cell].stamp & CLOSED_BIT ) ? CLOSED : OPEN;
+    }
+
+    double g( std::size_t cell )const
+    {
+        return isCurrent( cell ) ? cells_[cell].g : std::numeric_limits<double>::infinity();
+    }
+
+    unsigned char parentMove( std::size_t cell )const
+    {
+        return isCurrent( cell ) ? cells_[cell].parentMove : (unsigned char)NO_PARENT;
+    }
+
+    // Records a better path to the cell. Its path must have been put in the open
+    // set first, that opens the cell
+    void open( std::size_t cell, double g, unsigned char parentMove )
+    {
+        cells_[cell].g = g;
+        cells_[cell].parentMove = parentMove;
+    }
+
+    // The cell must have been opened in this search
+    void close( std::size_t cell ){ cells_[cell].stamp |= CLOSED_BIT; }
+};
+
+#endif // SEARCH_WORKSPACE_HPP
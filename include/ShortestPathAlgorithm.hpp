@@ -0,0 +1,69 @@
+#ifndef SHORTEST_PATH_ALGORITHM_HPP
+#define SHORTEST_PATH_ALGORITHM_HPP
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Node.hpp"
+#include "OccupancyGrid.hpp"
+#include "ProblemSpecification.hpp"
+#include "SearchStatistics.hpp"
+
+// Common interface of the search algorithms. They are run step by step, so the
+// visualizer can show the cells that each step adds to the open and close sets.
+class ShortestPathAlgorithm
+{
+  public:
+    // Cells added to the open and close sets in the last iteration
+    std::vector<GridPos> lastAdditionsToOpen;
+    GridPos lastAdditionToClose;
+
+  protected:
+    SearchStatistics statistics_;
+
+  private:
+    // The base is built before the members of the search, so the setup time
+    // counts their allocations too
+    const SearchStatistics::Clock::time_point created_ = SearchStatistics::now();
+
+  protected:
+    // Called at the end of the constructor of the searches
+    void finishSetup()
+    {
+        statistics_.setupMs = 0;
+        statistics_.addTime( statistics_.setupMs, created_ );
+    }
+
+  public:
+    virtual ~ShortestPathAlgorithm(){}
+
+    // Counters and timings of the search so far
+    const SearchStatistics& statistics()const{ return statistics_; }
+
+    // Performs one step of the search. Returns true when the search has finished
+    virtual bool nextIteration( bool debugInfo = true ) = 0;
+
+    // Cells of the shortest path, from the start to the goal. It is empty
+    // until the search finishes, and also if there is no path
+    virtual const std::vector<GridPos>& getShortestPath()const = 0;
+
+    // Adds or removes the obstacle of a cell. The algorithms that can repair
+    // their search do it in the next iterations and return true. The rest
+    // return false, and a new search has to be built for the new map.
+    virtual bool changeObstacle( unsigned /*x*/, unsigned /*y*/, bool /*isObstacle*/ ){ return false; }
+};
+
+// Builds the search algorithm to use for a problem. The obstacles are shared
+// with the search, not copied, and h is the heuristic number. The algorithms
+// that precompute data of the map keep it in cacheFile, if given.
+std::unique_ptr<ShortestPathAlgorithm> makeShortestPathAlgorithm(
+    algorithmName algorithm,
+    unsigned startX, unsigned startY,
+    unsigned endX, unsigned endY,
+    std::shared_ptr<const OccupancyGrid> obstacles,
+    unsigned h,
+    const std::string& cacheFile = ""
+);
+
+#endif // SHORTEST_PATH_ALGORITHM_HPP
@@ -0,0 +1,141 @@
+#ifndef TRACE_EVENTS_HPP
+#define TRACE_EVENTS_HPP
+
+#include <atomic>
+#include <chrono>
+#include <string>
+
+// The scopes are compiled in unless the project is built with -DTRACE_EVENTS=0.
+// Then TRACE_SCOPE is empty.
+#ifndef TRACE_EVENTS
+#define TRACE_EVENTS 1
+#endif
+
+// Records how long the scopes marked with TRACE_SCOPE take and writes them as
+// Chrome trace events, a JSON file that chrome://tracing, Perfetto
+// (ui.perfetto.dev) and speedscope open as a timeline, one row per thread.
+//
+// Nothing is recorded until start() is called. Until then a scope only reads a
+// flag, so the scopes can be left in the hot paths.
+class TraceRecorder
+{
+  public:
+    using Clock = std::chrono::steady_clock;
+
+  private:
+    static std::atomic<bool> recording_;
+
+  public:
+    // Starts recording. The events are kept in memory until stop() writes them to fileName
+    static void start( const std::string& fileName );
+
+    // Stops recording and writes the file. No scope can be running in another
+    // thread. Returns false if the file could not be written
+    static bool stop();
+
+    static bool isRecording(){ return recording_.load( std::memory_order_relaxed ); }
+
+    // Adds an event to the buffer of the calling thread. name and category are
+    // not copied, so they must be string literals, and they are written without
+    // escaping them
+    static void record( const char* name, const char* category, Clock::time_point start, Clock::time_point end );
+};
+
+// Records a trace while it exists, and writes it to the file when it is
+// destroyed. With an empty file name it does nothing
+class TraceSession
+{
+  private:
+    std::string fileName_;
+
+  public:
+    explicit TraceSession( const std::string& fileName );
+    ~TraceSession();
+
+    TraceSession( const TraceSession& ) = delete;
+    TraceSession& operator= ( const TraceSession& ) = delete;
+};
+
+// Records its own lifetime as an event, see TRACE_SCOPE
+class TraceScope
+{
+  private:
+    const char* name_;
+    const char* category_;
+    TraceRecorder::Clock::time_point start_;
+    bool recording_;
+
+  public:
+    TraceScope( const char* name, const char* category ):
+      name_( name ),
+      category_( category ),
+      recording_( TraceRecorder::isRecording() )
+    {
+        if( recording_ )
+            start_ = TraceRecorder::Clock::now();
+    }
+
+    ~TraceScope()
+    {
+        if( recording_ )
+            TraceRecorder::record( name_, category_, start_, TraceRecorder::Clock::now() );
+    }
+
+    TraceScope( const TraceScope& ) = delete;
+    TraceScope& operator= ( const TraceScope& ) = delete;
+};
+
+// Records as one event a phase that spans many calls, such as the iterations of
+// a search, from the first begin() to the next end(). It reads the clock only
+// at those two points, so begin() can be called in every iteration
+class TracePhase
+{
+  private:
+    const char* name_;
+    const char* category_;
+    TraceRecorder::Clock::time_point start_;
+    bool started_;
+
+  public:
+    TracePhase( const char* name, const char* category ):
+      name_( name ),
+      category_( category ),
+      started_( false )
+    {}
+
+    void begin()
+    {
+#if TRACE_EVENTS
+        if( !started_  &&  TraceRecorder::isRecording() )
+        {
+            start_ = TraceRecorder::Clock::now();
+            started_ = true;
+        }
+#endif
+    }
+
+    // Does nothing if the phase has not begun
+    void end()
+    {
+#if TRACE_EVENTS
+        if( started_ )
+        {
+            TraceRecorder::record( name_, category_, start_, TraceRecorder::Clock::now() );
+            started_ = false;
+        }
+#endif
+    }
+};
+
+#define TRACE_EVENTS_CONCAT_( a, b ) a##b
+#define TRACE_EVENTS_CONCAT( a, b ) TRACE_EVENTS_CONCAT_( a, b )
+
+// Records the time from here to the end of the enclosing block, with a name and
+// a category (a string literal each) that the trace viewers show and filter by
+#if TRACE_EVENTS
+#define TRACE_SCOPE( name, category ) TraceScope TRACE_EVENTS_CONCAT( traceScope, __LINE__ )( name, category )
+#else
+#define TRACE_SCOPE( name, category ) ((void)0)
+#endif
+
+#endif // TRACE_EVENTS_HPP
@@ -0,0 +1,120 @@
+#include "BatchQueryEngine.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <thread>
+
+BatchQueryEngine::BatchQueryEngine(
+    std::shared_ptr<const GridMap> map,
+    unsigned h,
+    unsigned numberOfWorkers
+):
+  map_( map ),
+  searches_()
+{
+    if( numberOfWorkers == 0 )
+        numberOfWorkers = std::max( 1u, std::thread::hardware_concurrency() );
+
+    // The searches only share the map, the rest of their state is their own
+    for( unsigned i = 0; i < numberOfWorkers; ++i )
+        searches_.emplace_back( new AStar( map_, 0, 0, 0, 0, h ) );
+}
+
+
+std::vector<PathQueryResult> BatchQueryEngine::solve( const std::vector<PathQuery>& queries )
+{
+    std::vector<PathQueryResult> results( queries.size() );
+
+    // Split the queries between the workers
+    std::vector<WorkQueue> queues( searches_.size() );
+    for( std::size_t i = 0; i < queries.size(); ++i )
+        queues[ i % queues.size() ].queries.push_back( i );
+
+    // Each worker only writes the results of the queries it takes, so
+    // the results vector does not need any synchronization
+    std::vector<std::thread> workers;
+    for( unsigned i = 1; i < searches_.size(); ++i )
+        workers.emplace_back( &BatchQueryEngine::work, this, i, std::ref(queues), std::cref(queries), std::ref(results) );
+
+    // The calling thread is the first worker
+    work( 0, queues, queries, results );
+
+    for( auto& worker : workers )
+        worker.join();
+
+    return results;
+}
+
+
+bool BatchQueryEngine::takeQuery( unsigned worker, std::vector<WorkQueue>& queues, std::size_t& query )const
+{
+    // Own queries first
+    {
+        std::lock_guard<std::mutex> lock( queues[worker].mutex );
+        if( !queues[worker].queries.empty() )
+        {
+            query = queues[worker].queries.front();
+            queues[worker].queries.pop_front();
+            return true;
+        }
+    }
+
+    // Steal from the other workers. No queries are added during a batch, so when
+    // every queue is empty there is nothing else to do
+    for( unsigned i = 1; i < queues.size(); ++i )
+    {
+        WorkQueue& victim = queues[ (worker + i) % queues.size() ];
+
+        std::lock_guard<std::mutex> lock( victim.mutex );
+        if( !victim.queries.empty() )
+        {
+            query = victim.queries.back();
+            victim.queries.pop_back();
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+void BatchQueryEngine::work( unsigned worker, std::vector<WorkQueue>& queues,
+                             const std::vector<PathQuery>& queries, std::vector<PathQueryResult>& results )
+{
+    AStar& search = *searches_[worker];
+
+    std::size_t i;
+    while( takeQuery( worker, queues, i ) )
+    {
+        // An exception cannot leave a worker thread, so the error of a query
+        // is kept in its result and the worker goes on with the next one
+        try
+        {
+            const PathQuery& query = queries[i];
+            if( query.start.x >= map_->numRows()  ||  query.start.y >= map_->numCols()
+            ||  query.goal.x >= map_->numRows()  ||  query.goal.y >= map_->numCols() )
+                throw std::out_of_range( "Query position outside the map." );
+
+            if( !map_->obstacles().isFree( query.start.x, query.start.y )
+            ||  !map_->obstacles().isFree( query.goal.x, query.goal.y ) )
+                throw std::invalid_argument( "Query position on an obstacle." );
+
+            search.reset( query.start.x, query.start.y, query.goal.x, query.goal.y );
+
+            long expansions = 0;
+            while( !search.nextIteration( false ) )
+                ++expansions;
+
+            results[i].path = search.getShortestPath();
+            results[i].expansions = expansions;
+        }
+        catch( const std::exception& e )
+        {
+            results[i].error = e.what();
+        }
+        catch( ... )
+        {
+            results[i].error = "Unknown error.";
+        }
+    }
+}
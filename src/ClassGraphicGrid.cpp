@@ -1,7 +1,10 @@
 #include "ClassGraphicGrid.hpp"
 #include <algorithm> // std::max
+#include <cmath>     // std::floor, std::ceil
 #include <stdexcept> // std::invalid_argument
 
+#include "TraceEvents.hpp"
+
 GraphicGrid GraphicGrid::init(
     const sf::Vector2u& gridStart,    // Point in the window that is the top left corner of the grid
     const sf::Vector2u& gridEnd,      // Point in the window that is the bottom right corner of the grid
@@ -9,8 +12,11 @@ GraphicGrid GraphicGrid::init(
     const int N,                      // Number of rows in the grid
     const std::string& spriteSheetLocation,   // Location in the file system of the spriteSheet to use
     const sf::Vector2u& texSz,        // Size of each sprite texture in the sprite sheet
-    const sf::Vector2u& defaultTexPos // Position of the texture sprite in the sheet to put in the cells as default        
+    const sf::Vector2u& defaultTexPos, // Position of the texture sprite in the sheet to put in the cells as default        
+    RenderMode renderMode             // How the cells are kept and drawn
 ){
+    TRACE_SCOPE( "GraphicGrid::init", "render" );
+
     // Check that the number of grid rows and columns are positive and one at least
     if( M < 1  || N < 1 )
         throw std::invalid_argument( "Invalid number of row/columns." );
@@ -25,7 +31,13 @@ GraphicGrid GraphicGrid::init(
     if ( !tex.loadFromFile(spriteSheetLocation) )
         throw std::invalid_argument( "Cannot open sprite sheet file." );
 
-    return GraphicGrid( gridStart, gridEnd, M, N, tex, texSz, defaultTexPos );
+    // The sheet must have a sprite at least, and in CELL_STATES mode the number of a
+    // sprite has to fit in the byte of a cell
+    if( texSz.x == 0  ||  texSz.y == 0  ||  tex.getSize().x < texSz.x  ||  tex.getSize().y < texSz.y
+    ||  ( renderMode == CELL_STATES  &&  (tex.getSize().x / texSz.x) * (tex.getSize().y / texSz.y) > 256 ) )
+        throw std::invalid_argument( "Invalid sprite size." );
+
+    return GraphicGrid( gridStart, gridEnd, M, N, tex, texSz, defaultTexPos, renderMode );
 }
 
 
@@ -37,7 +49,8 @@ GraphicGrid::GraphicGrid(
     const int N,
     const sf::Texture& spriteSheet,
     const sf::Vector2u& texSz,        // Size of each sprite texture in the sprite sheet
-    const sf::Vector2u& defaultTexPos // Position of the texture in the sheet to put in the cell as default
+    const sf::Vector2u& defaultTexPos, // Position of the texture in the sheet to put in the cell as default
+    RenderMode renderMode
 ): sf::Drawable(),
    M_( M ),
    N_( N ),
@@ -45,114 +58,341 @@ GraphicGrid::GraphicGrid(
    gridEnd_( gridEnd ),
    spriteSheet_( spriteSheet ),
    texSz_( texSz ),
-   cells_( sf::Quads, 0 ), // We indicate the real number of elements once we make sure that
-                          // the parameters are valid
+   chunksAlongY_( (N + CHUNK_CELLS - 1) / CHUNK_CELLS ),
+   renderMode_( renderMode ),
+   sheetColumns_( spriteSheet.getSize().x / texSz.x ),
+   stateTilesAlongY_( (N + STATE_TILE_CELLS - 1) / STATE_TILE_CELLS ),
+   texturesCreated_( false ),
    MIN_CELL_SZ( 10 )  
 {
-    // Auxiliar variable that holds the width and height that will have each cell in the grid
-    const sf::Vector2u cellSz = {
+    if( renderMode_ == CELL_STATES )
+    {
+        // All the cells start with the default sprite
+        states_.assign( (std::size_t)M_ * N_, defaultTexPos.y * sheetColumns_ + defaultTexPos.x );
+
+        // The color of a sprite is the average of its pixels, drawn over the white background
+        const sf::Image sheet = spriteSheet_.copyToImage();
+        const unsigned sheetRows = spriteSheet_.getSize().y / texSz_.y;
+        for( unsigned sprite = 0;  sprite < sheetColumns_ * sheetRows;  ++sprite )
+        {
+            unsigned long red = 0, green = 0, blue = 0;
+            for( unsigned i = 0;  i < texSz_.x;  ++i )
+                for( unsigned j = 0;  j < texSz_.y;  ++j )
+                {
+                    const sf::Color pixel = sheet.getPixel( (sprite % sheetColumns_) * texSz_.x + i,
+                                                            (sprite / sheetColumns_) * texSz_.y + j );
+                    red   += ( pixel.r * pixel.a + 255 * (255 - pixel.a) ) / 255;
+                    green += ( pixel.g * pixel.a + 255 * (255 - pixel.a) ) / 255;
+                    blue  += ( pixel.b * pixel.a + 255 * (255 - pixel.a) ) / 255;
+                }
+
+            const unsigned long pixels = (unsigned long)texSz_.x * texSz_.y;
+            stateColors_.push_back( sf::Color( red / pixels, green / pixels, blue / pixels ) );
+        }
+
+        // The tiles at the end of each axis can be smaller
+        for( unsigned x = 0;  x < (unsigned)M_;  x += STATE_TILE_CELLS )
+            for( unsigned y = 0;  y < (unsigned)N_;  y += STATE_TILE_CELLS )
+            {
+                const unsigned width = std::min<unsigned>( STATE_TILE_CELLS, M_ - x )
+                             , height = std::min<unsigned>( STATE_TILE_CELLS, N_ - y );
+                stateTiles_.push_back( { x, y, width, height, 0, 0, width, height, sf::Texture() } ); // Everything is uploaded the first time
+            }
+        return;
+    }
+
+    // Create the chunks, the last ones along each axis can be smaller
+    chunks_.reserve( (std::size_t)( (M_ + CHUNK_CELLS - 1) / CHUNK_CELLS ) * chunksAlongY_ );
+    for( unsigned x = 0;  x < (unsigned)M_;  x += CHUNK_CELLS )
+        for( unsigned y = 0;  y < (unsigned)N_;  y += CHUNK_CELLS )
+            chunks_.emplace_back( x, y, std::min<unsigned>( CHUNK_CELLS, M_ - x ), std::min<unsigned>( CHUNK_CELLS, N_ - y ) );
+
+    // Populate the chunks
+    for( unsigned x = 0;  x < (unsigned)M_;  ++x )
+        for( unsigned y = 0;  y < (unsigned)N_;  ++y )
+        {
+            Chunk& chunk = chunkOf( x, y );
+            setCellVertices( &chunk.vertices[ chunk.vertexIndex( x, y ) ], x, y, defaultTexPos );
+        }
+}
+
+
+void GraphicGrid::setCellVertices( sf::Vertex* cell, unsigned x, unsigned y, const sf::Vector2u& texPos )const
+{
+    const sf::Vector2u cellSz = cellSize();
+
+    // To calculate the position in pixels of the cells in the window we will take the
+    // logic position, that is in range [0, M*N), and multiply it by the size that each
+    // cell has, this way we have each cell with a width and height of cellSz.x and cellSz.y.
+    // Actually, to accomplish this for a cell we have to calculate the position for each vertex
+    // of the cell.
+
+    // Bottom left vertex
+    cell[0].position  = sf::Vector2f(
+            gridStart_.x + cellSz.x * x,
+            gridStart_.y + cellSz.y * (y + 1)
+    );
+    cell[0].texCoords = sf::Vector2f(
+            texSz_.x  * texPos.x,
+            texSz_.y  * (texPos.y + 1)
+    );
+
+    // Upper left vertex
+    cell[1].position  = sf::Vector2f(
+            gridStart_.x + cellSz.x * x,
+            gridStart_.y + cellSz.y * y
+    );
+    cell[1].texCoords = sf::Vector2f(
+            texSz_.x  * texPos.x,
+            texSz_.y  * texPos.y
+    );
+
+    // Upper right vertex
+    cell[2].position  = sf::Vector2f(
+            gridStart_.x + cellSz.x * (x + 1),
+            gridStart_.y + cellSz.y * y
+    );
+    cell[2].texCoords = sf::Vector2f(
+            texSz_.x  * (texPos.x + 1),
+            texSz_.y  * texPos.y
+    );
+
+    // Down right vertex
+    cell[3].position  = sf::Vector2f(
+            gridStart_.x + cellSz.x * (x + 1),
+            gridStart_.y + cellSz.y * (y + 1)
+    );
+    cell[3].texCoords = sf::Vector2f(
+            texSz_.x  * (texPos.x + 1),
+            texSz_.y  * (texPos.y + 1)
+    );
+}
+
+
+GraphicGrid::Chunk::Chunk( unsigned firstX, unsigned firstY, unsigned width, unsigned height ):
+   firstX( firstX ),
+   firstY( firstY ),
+   width( width ),
+   height( height ),
+   vertices( (std::size_t)width * height * 4 ),
+   buffer( sf::Quads, sf::VertexBuffer::Dynamic ),
+   dirtyBegin( 0 ),           // Everything is uploaded the first time
+   dirtyEnd( vertices.size() )
+{}
+
+
+void GraphicGrid::Chunk::draw( sf::RenderTarget& target, const sf::RenderStates& states )const
+{
+    // Without vertex buffers the vertices are sent every time they are drawn
+    if( !sf::VertexBuffer::isAvailable()  ||  ( buffer.getVertexCount() == 0  &&  !buffer.create( vertices.size() ) ) )
+    {
+        target.draw( vertices.data(), vertices.size(), sf::Quads, states );
+        return;
+    }
+
+    if( dirtyBegin < dirtyEnd )
+    {
+        TRACE_SCOPE( "GraphicGrid::uploadChunk", "render" );
+        buffer.update( &vertices[dirtyBegin], dirtyEnd - dirtyBegin, dirtyBegin );
+        dirtyBegin = vertices.size();
+        dirtyEnd = 0;
+    }
+
+    target.draw( buffer, states );
+}
+
+
+sf::Vector2u GraphicGrid::cellSize()const
+{
+    return {
         std::max( MIN_CELL_SZ, ((gridEnd_.x - gridStart_.x) / M_) ),  // x coordinate
         std::max( MIN_CELL_SZ, ((gridEnd_.y - gridStart_.y) / N_) )   // y coordinate
     };
+}
 
-    // Resize the cell vertices array
-    cells_.resize( N_ * M_ * 4 );
 
-    // Populate the array
-    for( unsigned x = 0;  x < M;  ++x )
-        for( unsigned y = 0;  y < N;  ++y )
-        {
-            // Because the cells array is one dimensional we have to translate the
-            // position from the 2d array view that the user has to the real 1 dimensional array position
-            unsigned pos = x * N_ + y;
-
-            // To calculate the position in pixels of the cells in the window we will take the
-            // logic position, that is in range [0, M*N), and multiply it by the size that each
-            // cell has, this way we have each cell with a width and height of cellSz.x and cellSz.y.
-            // Actually, to accomplish this for a cell we have to calculate the position for each vertex
-            // of the cell.
-
-            // Bottom left vertex
-            cells_[pos*4 + 0].position  = sf::Vector2f(
-                    gridStart.x + cellSz.x * x,
-                    gridStart.y + cellSz.y * (y + 1)
-            );
-            cells_[pos*4 + 0].texCoords = sf::Vector2f(
-                    texSz_.x  * defaultTexPos.x,
-                    texSz_.y  * (defaultTexPos.y + 1)
-            );
-
-            // Upper left vertex
-            cells_[pos*4 + 1].position  = sf::Vector2f(
-                    gridStart.x + cellSz.x * x,
-                    gridStart.y + cellSz.y * y
-            );
-            cells_[pos*4 + 1].texCoords = sf::Vector2f(
-                    texSz_.x  * defaultTexPos.x,
-                    texSz_.y  * defaultTexPos.y
-            );
-
-            // Upper right vertex
-            cells_[pos*4 + 2].position  = sf::Vector2f(
-                    gridStart.x + cellSz.x * (x + 1),
-                    gridStart.y + cellSz.y * y
-            );
-            cells_[pos*4 + 2].texCoords = sf::Vector2f(
-                    texSz_.x *  (defaultTexPos.x + 1),
-                    texSz_.y  * defaultTexPos.y
-            );
-
-            // Down right vertex
-            cells_[pos*4 + 3].position  = sf::Vector2f(
-                    gridStart.x + cellSz.x * (x + 1),
-                    gridStart.y + cellSz.y * (y + 1)
-            );
-            cells_[pos*4 + 3].texCoords = sf::Vector2f(
-                    texSz_.x  * (defaultTexPos.x + 1),
-                    texSz_.y  * (defaultTexPos.y + 1)
-            );
-        }
+bool GraphicGrid::visibleCells( const sf::View& view, int& firstX, int& lastX, int& firstY, int& lastY )const
+{
+    // Rectangle of the grid coordinates that the view shows
+    const sf::Vector2f viewStart = view.getCenter() - view.getSize() / 2.0f
+                     , viewEnd   = view.getCenter() + view.getSize() / 2.0f;
+    const sf::Vector2u cellSz = cellSize();
+
+    // Range [first, last) of the cells along an axis that are inside [from, to]
+    auto cellRange = []( float from, float to, unsigned gridStart, unsigned cellSz, int cells,
+                         int& first, int& last ){
+        const float firstCell = std::floor( (from - gridStart) / cellSz )
+                  , lastCell  = std::ceil( (to - gridStart) / cellSz );
+        first = (int)std::min<float>( std::max<float>( firstCell, 0 ), cells );
+        last  = (int)std::min<float>( std::max<float>( lastCell, 0 ), cells );
+    };
+
+    cellRange( viewStart.x, viewEnd.x, gridStart_.x, cellSz.x, M_, firstX, lastX );
+    cellRange( viewStart.y, viewEnd.y, gridStart_.y, cellSz.y, N_, firstY, lastY );
 
+    return firstX < lastX  &&  firstY < lastY;
 }
 
 
 void GraphicGrid::draw( sf::RenderTarget& target, sf::RenderStates states )const
 {
+    TRACE_SCOPE( "GraphicGrid::draw", "render" );
+
+    int firstX, lastX, firstY, lastY;
+    if( !visibleCells( target.getView(), firstX, lastX, firstY, lastY ) )
+        return;
+
+    if( renderMode_ == CELL_STATES )
+    {
+        drawCellStates( target, states, firstX, lastX, firstY, lastY );
+        return;
+    }
+
     // Apply the texture
     states.texture = &spriteSheet_;
 
-    // Draw the vertex array
-    target.draw( cells_, states );
+    // The chunks that have a visible cell
+    for( int chunkX = firstX / CHUNK_CELLS;  chunkX <= (lastX - 1) / CHUNK_CELLS;  ++chunkX )
+        for( int chunkY = firstY / CHUNK_CELLS;  chunkY <= (lastY - 1) / CHUNK_CELLS;  ++chunkY )
+            chunks_[ chunkX * chunksAlongY_ + chunkY ].draw( target, states );
+}
+
+
+void GraphicGrid::uploadStateTiles()const
+{
+    TRACE_SCOPE( "GraphicGrid::uploadStateTiles", "render" );
+
+    std::vector<sf::Uint8> pixels;
+    for( StateTile& tile : stateTiles_ )
+    {
+        if( !texturesCreated_ )
+        {
+            if( !tile.texture.create( tile.width, tile.height ) )
+                throw std::runtime_error( "Cannot create the textures of the grid." );
+            tile.texture.setSmooth( false );
+        }
+
+        if( tile.dirtyFirstX >= tile.dirtyLastX )
+            continue;
+
+        // The pixels are stored by rows, so y is the row of the texture
+        const unsigned width = tile.dirtyLastX - tile.dirtyFirstX
+                     , height = tile.dirtyLastY - tile.dirtyFirstY;
+        pixels.resize( (std::size_t)width * height * 4 );
+        sf::Uint8* pixel = pixels.data();
+        for( unsigned y = tile.dirtyFirstY;  y < tile.dirtyLastY;  ++y )
+            for( unsigned x = tile.dirtyFirstX;  x < tile.dirtyLastX;  ++x, pixel += 4 )
+            {
+                const sf::Color color = stateColors_[ states_[ (std::size_t)(tile.firstX + x) * N_ + tile.firstY + y ] ];
+                pixel[0] = color.r;
+                pixel[1] = color.g;
+                pixel[2] = color.b;
+                pixel[3] = color.a;
+            }
+
+        tile.texture.update( pixels.data(), width, height, tile.dirtyFirstX, tile.dirtyFirstY );
+        tile.dirtyFirstX = tile.width;
+        tile.dirtyFirstY = tile.height;
+        tile.dirtyLastX = 0;
+        tile.dirtyLastY = 0;
+    }
+
+    texturesCreated_ = true;
+}
+
+
+void GraphicGrid::drawCellStates( sf::RenderTarget& target, sf::RenderStates states,
+                                  int firstX, int lastX, int firstY, int lastY )const
+{
+    uploadStateTiles();
+
+    const sf::Vector2u cellSz = cellSize();
+    const float pixelsPerCell = target.getSize().x / target.getView().getSize().x * cellSz.x;
+
+    // Zoomed in the visible cells are few, and their sprites are drawn
+    if( pixelsPerCell >= MIN_SPRITE_PX )
+    {
+        spriteVertices_.resize( (std::size_t)(lastX - firstX) * (lastY - firstY) * 4 );
+        sf::Vertex* cell = spriteVertices_.data();
+        for( int x = firstX;  x < lastX;  ++x )
+            for( int y = firstY;  y < lastY;  ++y, cell += 4 )
+            {
+                const unsigned sprite = states_[ (std::size_t)x * N_ + y ];
+                setCellVertices( cell, x, y, { sprite % sheetColumns_, sprite / sheetColumns_ } );
+            }
+
+        states.texture = &spriteSheet_;
+        target.draw( spriteVertices_.data(), spriteVertices_.size(), sf::Quads, states );
+        return;
+    }
+
+    // Zoomed out each visible tile is a quad with a pixel of its texture per cell
+    for( const StateTile& tile : stateTiles_ )
+    {
+        if( (int)(tile.firstX + tile.width) <= firstX  ||  (int)tile.firstX >= lastX
+        ||  (int)(tile.firstY + tile.height) <= firstY  ||  (int)tile.firstY >= lastY )
+            continue;
+
+        const float left   = gridStart_.x + (float)cellSz.x * tile.firstX
+                  , top    = gridStart_.y + (float)cellSz.y * tile.firstY
+                  , right  = left + (float)cellSz.x * tile.width
+                  , bottom = top + (float)cellSz.y * tile.height;
+
+        const sf::Vertex quad[4] = {
+            sf::Vertex( { left,  bottom }, { 0.0f,              (float)tile.height } ),
+            sf::Vertex( { left,  top    }, { 0.0f,              0.0f } ),
+            sf::Vertex( { right, top    }, { (float)tile.width, 0.0f } ),
+            sf::Vertex( { right, bottom }, { (float)tile.width, (float)tile.height } )
+        };
+
+        states.texture = &tile.texture;
+        target.draw( quad, 4, sf::Quads, states );
+    }
 }
 
 
 void GraphicGrid::changeCellTexture( const sf::Vector2u& cellPos, const sf::Vector2u& texPosInSpriteSheet )
 {
+    TRACE_SCOPE( "GraphicGrid::changeCellTexture", "render" );
+
     // Checking for errors
     if( cellPos.x >= M_  || cellPos.y >= N_ )
         throw "TODO";
 
-    // Translating position from the 2d array view that the user has to the real 1 dimensional array position
-    unsigned pos = cellPos.x * N_ + cellPos.y;
+    if( renderMode_ == CELL_STATES )
+    {
+        states_[ (std::size_t)cellPos.x * N_ + cellPos.y ] = texPosInSpriteSheet.y * sheetColumns_ + texPosInSpriteSheet.x;
 
-    cells_[pos*4 + 0].texCoords = sf::Vector2f(
-            texSz_.x * texPosInSpriteSheet.x,
-            texSz_.y * (texPosInSpriteSheet.y + 1)
-    );
+        StateTile& tile = stateTileOf( cellPos.x, cellPos.y );
+        tile.dirtyFirstX = std::min( tile.dirtyFirstX, cellPos.x - tile.firstX );
+        tile.dirtyFirstY = std::min( tile.dirtyFirstY, cellPos.y - tile.firstY );
+        tile.dirtyLastX = std::max( tile.dirtyLastX, cellPos.x - tile.firstX + 1 );
+        tile.dirtyLastY = std::max( tile.dirtyLastY, cellPos.y - tile.firstY + 1 );
+        return;
+    }
 
-    cells_[pos*4 + 1].texCoords = sf::Vector2f(
-            texSz_.x * texPosInSpriteSheet.x,
-            texSz_.y * texPosInSpriteSheet.y
-    );
+    // The vertices of the cell in the array of its chunk
+    Chunk& chunk = chunkOf( cellPos.x, cellPos.y );
+    const std::size_t first = chunk.vertexIndex( cellPos.x, cellPos.y );
+    setCellVertices( &chunk.vertices[first], cellPos.x, cellPos.y, texPosInSpriteSheet );
 
-    cells_[pos*4 + 2].texCoords = sf::Vector2f(
-            texSz_.x * (texPosInSpriteSheet.x + 1),
-            texSz_.y * texPosInSpriteSheet.y
-    );
+    // They are uploaded the next time the chunk is drawn
+    chunk.dirtyBegin = std::min( chunk.dirtyBegin, first );
+    chunk.dirtyEnd = std::max( chunk.dirtyEnd, first + 4 );
+}
 
-    cells_[pos*4 + 3].texCoords = sf::Vector2f(
-            texSz_.x * (texPosInSpriteSheet.x + 1),
-            texSz_.y * (texPosInSpriteSheet.y + 1)
-    );
 
+bool GraphicGrid::cellAt( const sf::Vector2f& point, sf::Vector2u& cellPos )const
+{
+    const sf::Vector2u cellSz = cellSize();
+
+    if( point.x < gridStart_.x  ||  point.y < gridStart_.y )
+        return false;
+
+    cellPos = {
+        (unsigned)( (point.x - gridStart_.x) / cellSz.x ),
+        (unsigned)( (point.y - gridStart_.y) / cellSz.y )
+    };
+
+    return( cellPos.x < M_  &&  cellPos.y < N_ );
 }
@@ -0,0 +1,564 @@
+#include "HierarchicalAStar.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <stdexcept>
+
+#include "Heuristics.hpp"
+
+namespace
+{
+    // Entrances at least this long get a node at each end instead of one in the middle
+    enum { LONG_ENTRANCE = 6 };
+
+    // Header of the files where the graphs are saved
+    const char GRAPH_FILE_MAGIC[4] = { 'H', 'P', 'A', 'G' };
+    const std::uint32_t GRAPH_FILE_VERSION = 2;
+
+    template<class T>
+    void writeValue( std::ostream& output, T value )
+    {
+        output.write( reinterpret_cast<const char*>( &value ), sizeof(value) );
+    }
+
+    template<class T>
+    bool readValue( std::istream& input, T& value )
+    {
+        return (bool)input.read( reinterpret_cast<char*>( &value ), sizeof(value) );
+    }
+}
+
+
+AbstractGraph::AbstractGraph( unsigned M, unsigned N, unsigned clusterSize, std::uint64_t obstaclesHash ):
+  M_( M ),
+  N_( N ),
+  clusterSize_( clusterSize ),
+  obstaclesHash_( obstaclesHash )
+{}
+
+
+AbstractGraph::AbstractGraph( const OccupancyGrid& obstacles, unsigned clusterSize ):
+  AbstractGraph( obstacles.numRows(), obstacles.numCols(), clusterSize, hashObstacles( obstacles ) )
+{
+    if( clusterSize == 0 )
+        throw std::invalid_argument( "The cluster size must be positive." );
+
+    addEntrances( obstacles );
+    indexNodes();
+    addIntraClusterEdges( obstacles );
+}
+
+
+int AbstractGraph::addNode( std::size_t cell )
+{
+    // A cell at the corner of a cluster can be in two entrances, but it is a single node
+    const auto inserted = cellNodes_.emplace( cell, nodeCells_.size() );
+    if( inserted.second )
+    {
+        nodeCells_.push_back( cell );
+        edges_.emplace_back();
+    }
+
+    return inserted.first->second;
+}
+
+
+void AbstractGraph::addEntrances( const OccupancyGrid& obstacles )
+{
+    const unsigned C = clusterSize_;
+
+    // Joins the two cells at both sides of a border
+    auto link = [&]( std::size_t a, std::size_t b ){
+        const int nodeA = addNode( a )
+                , nodeB = addNode( b );
+        edges_[nodeA].push_back( {nodeB, 1} );
+        edges_[nodeB].push_back( {nodeA, 1} );
+    };
+
+    // Finds the entrances of a border of the given length. cellsAt(i) returns the
+    // pair of cells at both sides of the border in its position i
+    auto addBorder = [&]( unsigned length, auto cellsAt ){
+        auto isOpen = [&]( unsigned i ){
+            const auto cells = cellsAt( i );
+            return !obstacles.isObstacle( cells.first / N_, cells.first % N_ )
+                &&  !obstacles.isObstacle( cells.second / N_, cells.second % N_ );
+        };
+
+        unsigned i = 0;
+        while( i < length )
+        {
+            if( !isOpen(i) )
+            {
+                ++i;
+                continue;
+            }
+
+            unsigned end = i;
+            while( end < length  &&  isOpen(end) )
+                ++end;
+
+            if( end - i >= LONG_ENTRANCE )
+            {
+                link( cellsAt(i).first, cellsAt(i).second );
+                link( cellsAt(end - 1).first, cellsAt(end - 1).second );
+            }
+            else
+            {
+                const unsigned middle = ( i + end - 1 ) / 2;
+                link( cellsAt(middle).first, cellsAt(middle).second );
+            }
+
+            i = end;
+        }
+    };
+
+    // Borders between each cluster and the one below it (rows x and x + 1)
+    for( unsigned x = C - 1; x + 1 < M_; x += C )
+        for( unsigned y0 = 0; y0 < N_; y0 += C )
+            addBorder( std::min( C, N_ - y0 ), [&]( unsigned i ){
+                return std::make_pair( (std::size_t)x * N_ + y0 + i, (std::size_t)( x + 1 ) * N_ + y0 + i );
+            });
+
+    // Borders between each cluster and the one at its right (columns y and y + 1)
+    for( unsigned y = C - 1; y + 1 < N_; y += C )
+        for( unsigned x0 = 0; x0 < M_; x0 += C )
+            addBorder( std::min( C, M_ - x0 ), [&]( unsigned i ){
+                return std::make_pair( (std::size_t)( x0 + i ) * N_ + y, (std::size_t)( x0 + i ) * N_ + y + 1 );
+            });
+}
+
+
+void AbstractGraph::indexNodes()
+{
+    const std::size_t clusters = (std::size_t)( ( M_ + clusterSize_ - 1 ) / clusterSize_ ) * ( ( N_ + clusterSize_ - 1 ) / clusterSize_ );
+
+    clusterNodes_.assign( clusters, {} );
+    for( std::size_t node = 0; node < nodeCells_.size(); ++node )
+    {
+        cellNodes_[ nodeCells_[node] ] = node;
+        clusterNodes_[ clusterOf( nodeCells_[node] ) ].push_back( node );
+    }
+}
+
+
+void AbstractGraph::addIntraClusterEdges( const OccupancyGrid& obstacles )
+{
+    std::vector<int> distances;
+
+    for( const auto& nodes : clusterNodes_ )
+        for( int from : nodes )
+        {
+            clusterSearch( obstacles, nodeCells_[from], distances );
+
+            for( int to : nodes )
+            {
+                const int distance = distances[ localIndex( nodeCells_[to] ) ];
+                if( to != from  &&  distance > 0 )
+                    edges_[from].push_back( {to, distance} );
+            }
+        }
+}
+
+
+std::size_t AbstractGraph::clusterOf( std::size_t cell )const
+{
+    const std::size_t clustersPerRow = ( N_ + clusterSize_ - 1 ) / clusterSize_;
+    return ( cell / N_ / clusterSize_ ) * clustersPerRow + ( cell % N_ ) / clusterSize_;
+}
+
+
+unsigned AbstractGraph::localIndex( std::size_t cell )const
+{
+    return ( cell / N_ % clusterSize_ ) * clusterSize_ + cell % N_ % clusterSize_;
+}
+
+
+void AbstractGraph::clusterSearch( const OccupancyGrid& obstacles, std::size_t cell,
+                                   std::vector<int>& distances, std::vector<std::size_t>* parents )const
+{
+    const unsigned C = clusterSize_;
+    const int minX = cell / N_ / C * C
+            , minY = cell % N_ / C * C
+            , maxX = std::min( minX + C, M_ )
+            , maxY = std::min( minY + C, N_ );
+
+    distances.assign( C * C, -1 );
+    if( parents )
+        parents->assign( C * C, -1 );
+
+    std::vector<std::size_t> queue;
+    queue.reserve( C * C );
+    queue.push_back( cell );
+    distances[ localIndex(cell) ] = 0;
+
+    for( std::size_t head = 0; head < queue.size(); ++head )
+    {
+        const std::size_t current = queue[head];
+        const int distance = distances[ localIndex(current) ];
+
+        for( const GridOffset& offset : Node::NEIGHBOURS )
+        {
+            const int x = current / N_ + offset.x
+                    , y = current % N_ + offset.y;
+
+            if( x < minX  ||  x >= maxX  ||  y < minY  ||  y >= maxY )
+                continue;
+
+            const std::size_t next = (std::size_t)x * N_ + y;
+            if( obstacles.isObstacle( x, y )  ||  distances[ localIndex(next) ] != -1 )
+                continue;
+
+            distances[ localIndex(next) ] = distance + 1;
+            if( parents )
+                (*parents)[ localIndex(next) ] = current;
+            queue.push_back( next );
+        }
+    }
+}
+
+
+std::uint64_t AbstractGraph::hashObstacles( const OccupancyGrid& obstacles )
+{
+    // FNV-1a over the words of the grid, 64 cells at a time
+    std::uint64_t hash = 14695981039346656037ull;
+    auto add = [&]( std::uint64_t value ){
+        hash ^= value;
+        hash *= 1099511628211ull;
+    };
+
+    add( obstacles.numRows() );
+    add( obstacles.numCols() );
+    for( std::size_t i = 0; i < obstacles.numWords(); ++i )
+        add( obstacles.words()[i] );
+
+    return hash;
+}
+
+
+bool AbstractGraph::save( const std::string& fileName )const
+{
+    std::ofstream file( fileName.c_str(), std::ios::binary );
+    if( !file.is_open() )
+        return false;
+
+    file.write( GRAPH_FILE_MAGIC, sizeof(GRAPH_FILE_MAGIC) );
+    writeValue<std::uint32_t>( file, GRAPH_FILE_VERSION );
+    writeValue<std::uint32_t>( file, M_ );
+    writeValue<std::uint32_t>( file, N_ );
+    writeValue<std::uint32_t>( file, clusterSize_ );
+    writeValue<std::uint64_t>( file, obstaclesHash_ );
+    writeValue<std::uint32_t>( file, nodeCells_.size() );
+
+    for( std::size_t node = 0; node < nodeCells_.size(); ++node )
+    {
+        writeValue<std::uint64_t>( file, nodeCells_[node] );
+        writeValue<std::uint32_t>( file, edges_[node].size() );
+        for( const Edge& edge : edges_[node] )
+        {
+            writeValue<std::int32_t>( file, edge.to );
+            writeValue<std::int32_t>( file, edge.cost );
+        }
+    }
+
+    return (bool)file;
+}
+
+
+std::shared_ptr<const AbstractGraph> AbstractGraph::loadOrBuild(
+    const std::string& fileName,
+    const OccupancyGrid& obstacles,
+    unsigned clusterSize
+){
+    const unsigned M = obstacles.numRows()
+                 , N = obstacles.numCols();
+    const std::uint64_t obstaclesHash = hashObstacles( obstacles );
+    std::ifstream file( fileName.c_str(), std::ios::binary );
+
+    // We only use the saved graph if it belongs to the same map and every value in it is valid
+    char magic[ sizeof(GRAPH_FILE_MAGIC) ];
+    std::uint32_t version, rows, columns, savedClusterSize, numberOfNodes;
+    std::uint64_t savedHash;
+
+    if( file.is_open()
+        &&  file.read( magic, sizeof(magic) )  &&  std::equal( magic, magic + sizeof(magic), GRAPH_FILE_MAGIC )
+        &&  readValue( file, version )  &&  version == GRAPH_FILE_VERSION
+        &&  readValue( file, rows )  &&  rows == M
+        &&  readValue( file, columns )  &&  columns == N
+        &&  readValue( file, savedClusterSize )  &&  savedClusterSize == clusterSize
+        &&  readValue( file, savedHash )  &&  savedHash == obstaclesHash
+        &&  readValue( file, numberOfNodes )  &&  numberOfNodes <= (std::uint64_t)M * N )
+    {
+        std::shared_ptr<AbstractGraph> graph( new AbstractGraph( M, N, clusterSize, obstaclesHash ) );
+        bool valid = true;
+
+        for( std::uint32_t node = 0; valid  &&  node < numberOfNodes; ++node )
+        {
+            std::uint64_t cell;
+            std::uint32_t numberOfEdges;
+            valid = readValue( file, cell )  &&  cell < (std::uint64_t)M * N  &&  graph->cellNode( cell ) == -1
+                &&  readValue( file, numberOfEdges )  &&  numberOfEdges <= numberOfNodes;
+
+            if( valid )
+                graph->addNode( cell );
+
+            for( std::uint32_t i = 0; valid  &&  i < numberOfEdges; ++i )
+            {
+                std::int32_t to, cost;
+                valid = readValue( file, to )  &&  to >= 0  &&  (std::uint32_t)to < numberOfNodes
+                    &&  readValue( file, cost )  &&  cost > 0;
+
+                if( valid )
+                    graph->edges_[node].push_back( {to, cost} );
+            }
+        }
+
+        if( valid )
+        {
+            graph->indexNodes();
+            return graph;
+        }
+    }
+
+    auto graph = std::make_shared<const AbstractGraph>( obstacles, clusterSize );
+    if( !graph->save( fileName ) )
+        std::cerr << "Cannot save the abstract graph to " << fileName << '\n';
+
+    return graph;
+}
+
+
+HierarchicalAStar::HierarchicalAStar(
+    std::shared_ptr<const AbstractGraph> graph,
+    std::shared_ptr<const OccupancyGrid> obstacles,
+    unsigned startX, unsigned startY,
+    unsigned endX, unsigned endY,
+    unsigned h
+):
+  graph_( graph ),
+  obstacles_( obstacles ),
+  h_( (h < NUMBER_OF_HEURISTIC_FUNCTIONS) ? h : 0 ),
+  finished_( false ),
+  start_( {startX, startY} ),
+  end_( {endX, endY} )
+{
+    const std::size_t N = graph_->numCols()
+                    , startCell = startX * N + startY
+                    , endCell = endX * N + endY
+                    , startCluster = graph_->clusterOf( startCell )
+                    , endCluster = graph_->clusterOf( endCell );
+
+    startNode_ = graph_->cellNode( startCell );
+    endNode_ = graph_->cellNode( endCell );
+
+    std::vector<int> distances;
+
+    // The goal is joined to the nodes of its cluster that can reach it
+    if( endNode_ == -1 )
+    {
+        endNode_ = graph_->numNodes() + 1;
+        graph_->clusterSearch( *obstacles_, endCell, distances );
+
+        for( int node : graph_->clusterNodes( endCluster ) )
+        {
+            const int distance = distances[ graph_->localIndex( graph_->nodeCell(node) ) ];
+            if( distance > 0 )
+                endEdges_.push_back( {node, distance} );
+        }
+    }
+
+    // The start is joined to the nodes of its cluster it can reach, and directly to
+    // the goal when it is in the same cluster and is not a node either
+    if( startNode_ == -1 )
+    {
+        startNode_ = graph_->numNodes();
+        graph_->clusterSearch( *obstacles_, startCell, distances );
+
+        for( int node : graph_->clusterNodes( startCluster ) )
+        {
+            const int distance = distances[ graph_->localIndex( graph_->nodeCell(node) ) ];
+            if( distance > 0 )
+                startEdges_.push_back( {node, distance} );
+        }
+
+        const int distance = distances[ graph_->localIndex( endCell ) ];
+        if( startCluster == endCluster  &&  isTemporary( endNode_ )  &&  distance >= 0 )
+            startEdges_.push_back( {endNode_, distance} );
+    }
+
+    nodes_[ startNode_ ] = { 0, NO_PARENT, false };
+    openSet_.emplace_back( heuristic( startNode_ ), 0, startNode_ );
+    statistics_.generated();
+    statistics_.heuristicCall();
+    statistics_.openSize( 1 );
+    finishSetup();
+}
+
+
+std::size_t HierarchicalAStar::nodeCell( int node )const
+{
+    if( node == startNode_  &&  isTemporary( node ) )
+        return (std::size_t)start_.x * graph_->numCols() + start_.y;
+
+    if( node == endNode_  &&  isTemporary( node ) )
+        return (std::size_t)end_.x * graph_->numCols() + end_.y;
+
+    return graph_->nodeCell( node );
+}
+
+
+GridPos HierarchicalAStar::nodePos( int node )const
+{
+    const std::size_t cell = nodeCell( node );
+    return { unsigned( cell / graph_->numCols() ), unsigned( cell % graph_->numCols() ) };
+}
+
+
+double HierarchicalAStar::heuristic( int node )const
+{
+    const GridPos pos = nodePos( node );
+    return visitHeuristic( h_, [&]( auto heuristic ){
+        return heuristic( pos.x, pos.y, end_.x, end_.y );
+    });
+}
+
+
+void HierarchicalAStar::relax( int from, int to, double cost )
+{
+    const double newG = nodes_[from].g + cost;
+
+    // If we already have a path to the node that is not worse we do nothing with it
+    auto it = nodes_.find( to );
+    if( it != nodes_.end()  &&  ( it->second.closed  ||  it->second.g <= newG ) )
+    {
+        statistics_.duplicate();
+        return;
+    }
+
+    nodes_[to] = { newG, from, false };
+    openSet_.emplace_back( newG + heuristic( to ), -newG, to );
+    std::push_heap( openSet_.begin(), openSet_.end(), std::greater<OpenEntry>() );
+    lastAdditionsToOpen.push_back( nodePos( to ) );
+    statistics_.generated();
+    statistics_.heuristicCall();
+}
+
+
+void HierarchicalAStar::buildShortestPath()
+{
+    const auto start = SearchStatistics::now();
+    std::vector<int> abstractPath;
+    for( int node = endNode_;  node != NO_PARENT;  node = nodes_[node].parent )
+        abstractPath.push_back( node );
+    std::reverse( abstractPath.begin(), abstractPath.end() );
+
+    const std::size_t N = graph_->numCols();
+    std::vector<int> distances;
+    std::vector<std::size_t> parents;
+    std::vector<GridPos> segment;
+
+    shortestPath_.assign( 1, start_ );
+
+    // Consecutive nodes are either neighbour cells or cells of the same cluster,
+    // so each step is refined with a search inside its cluster
+    for( std::size_t i = 1; i < abstractPath.size(); ++i )
+    {
+        const std::size_t from = nodeCell( abstractPath[i - 1] )
+                        , to = nodeCell( abstractPath[i] );
+
+        segment.clear();
+        if( graph_->clusterOf( from ) != graph_->clusterOf( to ) )
+            segment.push_back( {unsigned( to / N ), unsigned( to % N )} );
+        else
+        {
+            graph_->clusterSearch( *obstacles_, from, distances, &parents );
+            for( std::size_t cell = to;  cell != from;  cell = parents[ graph_->localIndex(cell) ] )
+                segment.push_back( {unsigned( cell / N ), unsigned( cell % N )} );
+        }
+
+        shortestPath_.insert( shortestPath_.end(), segment.rbegin(), segment.rend() );
+    }
+
+    statistics_.addTime( statistics_.pathMs, start );
+}
+
+
+bool HierarchicalAStar::nextIteration( bool debugInfo )
+{
+    statistics_.iterationStarted();
+    const bool finished = step( debugInfo );
+
+    // The abstract graph is shared, only the state of this query is counted
+    if( finished )
+    {
+        statistics_.searchFinished();
+        statistics_.memory( openSet_.capacity() * sizeof(OpenEntry)
+                            + nodes_.size() * sizeof(std::pair<const int, NodeState>)
+                            + nodes_.bucket_count() * sizeof(void*)
+                            + ( startEdges_.capacity() + endEdges_.capacity() ) * sizeof(AbstractGraph::Edge)
+                            + shortestPath_.capacity() * sizeof(GridPos) );
+    }
+    return finished;
+}
+
+
+bool HierarchicalAStar::step( bool debugInfo )
+{
+    lastAdditionToClose = {};
+    lastAdditionsToOpen.clear();
+
+    if( finished_ )
+        return true;
+
+    // Entries of nodes that were closed with a better cost are skipped
+    const std::greater<OpenEntry> compare;
+    while( !openSet_.empty()  &&  nodes_[ std::get<2>( openSet_.front() ) ].closed )
+    {
+        std::pop_heap( openSet_.begin(), openSet_.end(), compare );
+        openSet_.pop_back();
+    }
+
+    // Check if the open set has no elements -> no solution
+    if( openSet_.empty() )
+    {
+        finished_ = true;
+        return true;
+    }
+
+    std::pop_heap( openSet_.begin(), openSet_.end(), compare );
+    const int current = std::get<2>( openSet_.back() );
+    openSet_.pop_back();
+
+    if( debugInfo )
+    {
+        const GridPos pos = nodePos( current );
+        std::cerr << "Current node: " << current << " (" << pos.x << ',' << pos.y << ")\n";
+        std::cerr << "Cost: " << nodes_[current].g << ", h: " << heuristic( current ) << '\n';
+    }
+
+    // Check if current node is the goal -> finished with solution
+    if( current == endNode_ )
+    {
+        buildShortestPath();
+        finished_ = true;
+        return true;
+    }
+
+    nodes_[current].closed = true;
+    lastAdditionToClose = nodePos( current );
+    statistics_.expanded();
+
+    const std::vector<AbstractGraph::Edge>& edges =
+        ( current == startNode_  &&  isTemporary( current ) ) ? startEdges_ : graph_->edges( current );
+
+    for( const AbstractGraph::Edge& edge : edges )
+        relax( current, edge.to, edge.cost );
+
+    for( const AbstractGraph::Edge& edge : endEdges_ )
+        if( edge.to == current )
+            relax( current, endNode_, edge.cost );
+
+    statistics_.openSize( openSet_.size() );
+    return false;
+}
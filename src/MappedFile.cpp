@@ -0,0 +1,60 @@
+#include "MappedFile.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+MappedFile::MappedFile( const std::string& fileName, AccessPattern access ):
+  fileName_( fileName ),
+  data_( nullptr ),
+  size_( 0 )
+{
+    const int file = open( fileName.c_str(), O_RDONLY );
+    struct stat fileStatus;
+
+    if( file < 0  ||  fstat( file, &fileStatus ) != 0 )
+    {
+        const int error = errno;
+        if( file >= 0 )
+            close( file );
+        throw std::invalid_argument( "Error loading the file " + fileName + ": " + std::strerror( error ) + "." );
+    }
+
+    // An empty file can not be mapped, but there is nothing to read in it
+    if( fileStatus.st_size > 0 )
+    {
+        void* contents = mmap( nullptr, fileStatus.st_size, PROT_READ, MAP_PRIVATE, file, 0 );
+        if( contents == MAP_FAILED )
+        {
+            const int error = errno;
+            close( file );
+            throw std::invalid_argument( "Error loading the file " + fileName + ": " + std::strerror( error ) + "." );
+        }
+
+        data_ = static_cast<const char*>( contents );
+        size_ = fileStatus.st_size;
+        advise( access );
+    }
+
+    // The mapping stays valid after the file is closed
+    close( file );
+}
+
+
+MappedFile::~MappedFile()
+{
+    if( data_ != nullptr )
+        munmap( const_cast<char*>( data_ ), size_ );
+}
+
+
+void MappedFile::advise( AccessPattern access )const
+{
+    if( data_ != nullptr )
+        madvise( const_cast<char*>( data_ ), size_, access == SEQUENTIAL_ACCESS ? MADV_SEQUENTIAL : MADV_RANDOM );
+}
@@ -0,0 +1,4 @@
+#include "Node.hpp"
+
+// Positions of the neighbour relative to a cell
+const Matrix2i Node::NEIGHBOURS = { {0, -1}, {-1, 0}, {+1, 0}, {0, +1} };
@@ -1,87 +1,378 @@
 
 #include "ProblemSpecification.hpp"
 
-problemSpecification::problemSpecification(std::string &file_name){
+#include <climits>
+#include <cstring>
+
+#include "TraceEvents.hpp"
+
+// Binary map format. All the values are in the byte order of the machine that
+// wrote the file, byte_order tells whether it is the same one:
+//
+//   char magic[4] = "SPMB", uint32 version, uint64 byte_order = 0x0102030405060708,
+//   uint32 heuristic, algorithm, rows, columns, car x, car y, final x, final y,
+//   the words of the OccupancyGrid as returned by words(),
+//   uint32 number of obstacle changes, and for each one uint32 x, y, add,
+//   uint32 length of the cache file and its characters.
+//
+// The header takes 48 bytes, so the words are aligned and the grid is used
+// directly from the mapped file.
+namespace {
+
+const char BINARY_MAP_MAGIC[4] = {'S', 'P', 'M', 'B'};
+const std::uint32_t BINARY_MAP_VERSION = 1;
+const std::uint64_t BINARY_MAP_BYTE_ORDER = 0x0102030405060708ull;
+const std::size_t BINARY_MAP_HEADER_SIZE = 48;
+
+template <class T>
+void writeValue(std::ostream &output, T value) {
+  output.write(reinterpret_cast<const char *>(&value), sizeof(value));
+}
 
-  if (file_name == "") {
-    file_name = DEFAULT_FILE_PATH;
+}
+
+// Problem file mapped in memory and read token by token. It keeps the line
+// and column of the last token, so the errors can tell where they are.
+class problemFileReader {
+
+ public:
+
+  // Reads the mapped file.
+  explicit problemFileReader(std::shared_ptr<const MappedFile> file);
+
+  // Returns true if there is nothing but blanks left in the file.
+  bool atEnd(void);
+
+  // Returns true if the next token starts like an integer.
+  bool nextIsInteger(void);
+
+  // Reads an integer. what is the name of the value for the error message,
+  // and of what it is part of, if any. Throws std::invalid_argument if the
+  // next token is not an integer.
+  long long readInteger(const char *what, const char *of = nullptr);
+
+  // Reads the next token, up to the next blank.
+  std::string readWord(const char *what);
+
+  // Returns "file:line:column" of the last token read.
+  std::string where(void) const;
+
+ private:
+
+  std::shared_ptr<const MappedFile> file_;
+  const char *begin_;       // Contents of the file.
+  const char *end_;
+  const char *current_;     // Next character to read.
+  const char *line_start_;  // First character of the line of current_.
+  int line_;
+  const char *token_;       // First character of the last token.
+  int token_line_;
+  const char *token_line_start_;
+
+  static bool isBlank(char c) { return c == ' ' || c == '\n' || c == '\t' || c == '\r'; }
+
+  void skipBlanks(void);
+  void startToken(void);
+  [[noreturn]] void fail(const std::string &message) const;
+};
+
+problemFileReader::problemFileReader(std::shared_ptr<const MappedFile> file):
+  file_(file), begin_(file_->data()), end_(begin_ + file_->size()), line_(1), token_line_(1) {
+
+  current_ = line_start_ = token_ = token_line_start_ = begin_;
+}
+
+void problemFileReader::skipBlanks(void) {
+
+  while (current_ != end_ && isBlank(*current_)) {
+    if (*current_ == '\n') {
+      ++line_;
+      line_start_ = current_ + 1;
+    }
+    ++current_;
   }
+}
+
+void problemFileReader::startToken(void) {
+  skipBlanks();
+  token_ = current_;
+  token_line_ = line_;
+  token_line_start_ = line_start_;
+}
+
+bool problemFileReader::atEnd(void) {
+  skipBlanks();
+  return current_ == end_;
+}
+
+bool problemFileReader::nextIsInteger(void) {
+  skipBlanks();
+  const char *p = current_;
+  if (p != end_ && *p == '-')
+    ++p;
+  return p != end_ && *p >= '0' && *p <= '9';
+}
 
-  // We open the file in an input stream.
-  std::ifstream input_text_file(file_name.c_str());
+long long problemFileReader::readInteger(const char *what, const char *of) {
 
-  if(input_text_file.is_open()) {
+  startToken();
 
-    // We read the heusristic number from file and then we cast it
-    // to our enum configuration.
-    int heuristic_number;
-    input_text_file >> heuristic_number;
-    heuristic_ = static_cast<heuristicsName>(heuristic_number);
+  // The name is only built if there is an error.
+  auto name = [&]() {
+    return of == nullptr ? std::string(what) : std::string(what) + " of " + of;
+  };
 
-    // We read number of columns and rows.
-    input_text_file >> number_of_colums_;
-    input_text_file >> number_of_rows_ ;
+  bool negative = false;
+  if (current_ != end_ && *current_ == '-') {
+    negative = true;
+    ++current_;
+  }
 
-    position car_position;
-    // We read the intial car position.
-    input_text_file >> car_position.x;
-    input_text_file >> car_position.y;
+  if (current_ == end_ || *current_ < '0' || *current_ > '9')
+    fail("Expected " + name() + ", an integer.");
 
-    // We store the car position in vector.
-    car_position_ = vectorPos(car_position);
+  // We accumulate the digits while they fit in 64 bits.
+  long long value = 0;
+  for (; current_ != end_ && *current_ >= '0' && *current_ <= '9'; ++current_) {
+    if (value > (LLONG_MAX - (*current_ - '0')) / 10)
+      fail("The value of " + name() + " is too big.");
+    value = value * 10 + (*current_ - '0');
+  }
 
-    position final_position;
-    // We read the final position.
-    input_text_file >> final_position.x;
-    input_text_file >> final_position.y;
+  // The integer must end at a blank or at the end of the file.
+  if (current_ != end_ && !isBlank(*current_))
+    fail("Expected " + name() + ", an integer.");
 
-    // We store the final position in vector.
-    final_position_ = vectorPos(final_position);
+  return negative ? -value : value;
+}
 
-    // We read the number of obstacles that user want.
-    int number_of_obstacles;
-    input_text_file >>  number_of_obstacles;
+std::string problemFileReader::readWord(const char *what) {
 
+  startToken();
 
-    if (variablesAreConfigured(number_of_obstacles)) {
+  while (current_ != end_ && !isBlank(*current_))
+    ++current_;
 
-      int obstacles_entered = 0;
+  if (current_ == token_)
+    fail(std::string("Expected ") + what + ".");
 
-      while (!input_text_file.eof() && obstacles_entered < number_of_obstacles) {
+  return std::string(token_, current_);
+}
 
-        position obstacle_pos;
-        input_text_file >> obstacle_pos.x;
-        input_text_file >> obstacle_pos.y;
+std::string problemFileReader::where(void) const {
+  return file_->fileName() + ":" + std::to_string(token_line_) + ":" +
+         std::to_string(token_ - token_line_start_ + 1);
+}
 
-        if (!input_text_file.eof() && !positionIsIntroduced(vectorPos(obstacle_pos)) ){
-          obstacle_positions_.push_back(vectorPos(obstacle_pos));
-          obstacles_entered++;
-        }
+void problemFileReader::fail(const std::string &message) const {
+  throw std::invalid_argument(where() + ": " + message);
+}
 
-      }
 
-      if (obstacles_entered < number_of_obstacles) {
-        generateRandomObstacles(number_of_obstacles - obstacles_entered);
-      }
+algorithmName algorithmFromName(const std::string &name) {
 
+  for (std::size_t i = 0; i < ALGORITHM_NAMES.size(); ++i) {
+    if (ALGORITHM_NAMES[i] == name)
+      return static_cast<algorithmName>(i);
+  }
 
-    } else {
+  throw std::invalid_argument("Unknown algorithm " + name + ".");
+}
 
-      input_text_file.close();
-      throw std::out_of_range("One of the arguments is out of range.");
+std::uint64_t randomBelow(std::mt19937 &generator, std::uint64_t bound) {
+
+  // mt19937 gives the same numbers everywhere, and we draw the number from it
+  // ourselves because the standard distributions change between libraries.
+  // Lemire's method: the high half of random * bound, rejecting the few
+  // values that would make some results more probable than others. The
+  // bounds of more than 32 bits take two numbers of the generator.
+  if (bound <= UINT32_MAX) {
+    const std::uint32_t bound32 = bound;
+    std::uint64_t product = std::uint64_t(generator()) * bound32;
+    if (std::uint32_t(product) < bound32) {
+      const std::uint32_t threshold = -bound32 % bound32;
+      while (std::uint32_t(product) < threshold)
+        product = std::uint64_t(generator()) * bound32;
     }
+    return std::uint64_t(product >> 32);
+  }
 
-  } else {
-    throw std::invalid_argument("Error loading the configuration file of the project.");
+  auto random64 = [&]() { return (std::uint64_t(generator()) << 32) | generator(); };
+  unsigned __int128 product = (unsigned __int128)random64() * bound;
+  if (std::uint64_t(product) < bound) {
+    const std::uint64_t threshold = -bound % bound;
+    while (std::uint64_t(product) < threshold)
+      product = (unsigned __int128)random64() * bound;
+  }
+  return std::uint64_t(product >> 64);
+}
+
+problemSpecification::problemSpecification(std::string &file_name):
+  algorithm_(A_STAR),
+  seed_(std::chrono::system_clock::now().time_since_epoch().count()) {
+
+  TRACE_SCOPE("problemSpecification::load", "load");
+
+  if (file_name == "") {
+    file_name = DEFAULT_FILE_PATH;
+  }
+
+  // We map the file in memory. The binary maps are used as they are, and
+  // the text files are read token by token.
+  std::shared_ptr<const MappedFile> file =
+      std::make_shared<const MappedFile>(file_name, MappedFile::SEQUENTIAL_ACCESS);
+
+  if (file->size() >= sizeof(BINARY_MAP_MAGIC) &&
+      std::equal(BINARY_MAP_MAGIC, BINARY_MAP_MAGIC + sizeof(BINARY_MAP_MAGIC), file->data())) {
+    loadBinary(file);
+    return;
+  }
+
+  problemFileReader input(file);
+
+  // Each value is checked when it is read, so the errors tell where
+  // the wrong value is.
+
+  // We read the heusristic number from file and then we cast it
+  // to our enum configuration.
+  const long long heuristic_number = input.readInteger("the heuristic");
+  if (heuristic_number < 0 || heuristic_number >= NUMBER_OF_HEURISTICS)
+    throw std::out_of_range(input.where() + ": The heuristic must be between 0 and " +
+                            std::to_string(NUMBER_OF_HEURISTICS - 1) + ".");
+  heuristic_ = static_cast<heuristicsName>(heuristic_number);
+
+  // We read number of columns and rows. The size of the grid is only
+  // limited by the memory, the cells are counted in 64 bits.
+  const long long columns = input.readInteger("the number of columns");
+  if (columns < 0 || columns > INT_MAX)
+    throw std::out_of_range(input.where() + ": The number of columns must be between 0 and " +
+                            std::to_string(INT_MAX) + ".");
+  number_of_colums_ = columns;
+
+  const long long rows = input.readInteger("the number of rows");
+  if (rows < 0 || rows > INT_MAX)
+    throw std::out_of_range(input.where() + ": The number of rows must be between 0 and " +
+                            std::to_string(INT_MAX) + ".");
+  number_of_rows_ = rows;
+
+  // We need a cell for the car and another one for the final position.
+  const std::int64_t number_of_cells = std::int64_t(number_of_rows_) * number_of_colums_;
+  if (number_of_cells < 2)
+    throw std::out_of_range(input.where() + ": The grid must have at least 2 cells, for the car and "
+                            "the final position.");
+
+  // We read the intial car position and the final position, and we
+  // store them in vector.
+  car_position_ = readPosition(input, "the car position");
+  if (car_position_ < 0)
+    throw std::out_of_range(input.where() + ": The car position is outside the grid.");
+
+  final_position_ = readPosition(input, "the final position");
+  if (final_position_ < 0)
+    throw std::out_of_range(input.where() + ": The final position is outside the grid.");
+
+  // We read the number of obstacles that user want. The car and final
+  // positions can not be obstacles.
+  const long long number_of_obstacles = input.readInteger("the number of obstacles");
+  if (number_of_obstacles < 0 || number_of_obstacles > number_of_cells - 2)
+    throw std::out_of_range(input.where() + ": The number of obstacles must be between 0 and " +
+                            std::to_string(std::max<std::int64_t>(0, number_of_cells - 2)) + ".");
+
+  try {
+    obstacles_ = std::make_shared<OccupancyGrid>(number_of_rows_, number_of_colums_);
+  } catch (const std::bad_alloc &) {
+    throw std::out_of_range(input.where() + ": A grid of " + std::to_string(number_of_rows_) + "x" +
+                            std::to_string(number_of_colums_) + " cells does not fit in memory.");
+  }
+  std::int64_t obstacles_entered = 0;
+
+  // The list of obstacles can be shorter than the number of obstacles,
+  // and it ends with the end of the file or with the first directive.
+  // The repeated positions are skipped, the grid tells us in constant time.
+  while (obstacles_entered < number_of_obstacles && input.nextIsInteger()) {
+
+    const std::int64_t obstacle_pos = readPosition(input, "the obstacle");
+    if (obstacle_pos < 0)
+      throw std::out_of_range(input.where() + ": Obstacle outside the grid.");
+
+    if (!positionIsIntroduced(obstacle_pos)) {
+      const position matrix_pos = matrixPos(obstacle_pos);
+      obstacles_->setObstacle(matrix_pos.x, matrix_pos.y, true);
+      obstacles_entered++;
+    }
+
+  }
+
+  // The obstacles listed beyond their number are ignored, as they have always
+  // been, so the files that have them still load.
+  while (input.nextIsInteger())
+    input.readWord("an obstacle");
+
+  readDirectives(input);
+
+  if (obstacles_entered < number_of_obstacles) {
+    generateRandomObstacles(number_of_obstacles - obstacles_entered);
   }
 }
 
 problemSpecification::~problemSpecification(){}
 
+bool problemSpecification::saveBinary(const std::string &file_name) const {
+
+  TRACE_SCOPE("problemSpecification::saveBinary", "load");
+
+  std::ofstream file(file_name.c_str(), std::ios::binary);
+  if (!file.is_open())
+    return false;
+
+  file.write(BINARY_MAP_MAGIC, sizeof(BINARY_MAP_MAGIC));
+  writeValue<std::uint32_t>(file, BINARY_MAP_VERSION);
+  writeValue<std::uint64_t>(file, BINARY_MAP_BYTE_ORDER);
+  writeValue<std::uint32_t>(file, heuristic_);
+  writeValue<std::uint32_t>(file, algorithm_);
+  writeValue<std::uint32_t>(file, number_of_rows_);
+  writeValue<std::uint32_t>(file, number_of_colums_);
+  writeValue<std::uint32_t>(file, car_position().x);
+  writeValue<std::uint32_t>(file, car_position().y);
+  writeValue<std::uint32_t>(file, final_position().x);
+  writeValue<std::uint32_t>(file, final_position().y);
+
+  file.write(reinterpret_cast<const char *>(obstacles_->words()),
+             obstacles_->numWords() * sizeof(std::uint64_t));
+
+  writeValue<std::uint32_t>(file, obstacle_changes_.size());
+  for (const obstacleChange &change : obstacle_changes_) {
+    writeValue<std::uint32_t>(file, change.pos.x);
+    writeValue<std::uint32_t>(file, change.pos.y);
+    writeValue<std::uint32_t>(file, change.add);
+  }
+
+  writeValue<std::uint32_t>(file, cache_file_.size());
+  file.write(cache_file_.data(), cache_file_.size());
+
+  return (bool)file;
+}
+
 heuristicsName problemSpecification::heuristic(void) const {
     return heuristic_;
 }
 
+algorithmName problemSpecification::algorithm(void) const {
+    return algorithm_;
+}
+
+std::string problemSpecification::cacheFile(void) const {
+    return cache_file_;
+}
+
+std::uint64_t problemSpecification::seed(void) const {
+    return seed_;
+}
+
+const std::vector<obstacleChange>& problemSpecification::obstacleChanges(void) const {
+    return obstacle_changes_;
+}
+
 int problemSpecification::rows(void) const {
     return number_of_rows_;
 }
@@ -98,67 +389,171 @@ position problemSpecification::final_position(void) const {
     return matrixPos(final_position_);
 }
 
-int problemSpecification::getNumberOfObstaces(void) const {
-    return obstacle_positions_.size();
+std::size_t problemSpecification::getNumberOfObstaces(void) const {
+    return obstacles_->count();
 }
 
-position problemSpecification::getObstacle(int i) const {
-    return matrixPos(obstacle_positions_[i]);
+std::shared_ptr<const OccupancyGrid> problemSpecification::obstacles(void) const {
+    return obstacles_;
 }
 
 // PRIVATE METHODS.
 
-int problemSpecification::vectorPos(const position matrix_position) const {
-  return matrix_position.y + number_of_colums_ * matrix_position.x;
+std::int64_t problemSpecification::vectorPos(const position matrix_position) const {
+  return matrix_position.y + std::int64_t(number_of_colums_) * matrix_position.x;
 }
 
-position problemSpecification::matrixPos(const int vector_position) const {
+position problemSpecification::matrixPos(const std::int64_t vector_position) const {
 
   position matrix_pos;
 
-  matrix_pos.x = static_cast<int>(vector_position / columns());
-  matrix_pos.y = vector_position - (matrix_pos.x  * columns());
+  matrix_pos.x = static_cast<unsigned>(vector_position / columns());
+  matrix_pos.y = vector_position - (std::int64_t(matrix_pos.x) * columns());
 
   return matrix_pos;
 }
 
 
-bool problemSpecification::variablesAreConfigured(int number_of_obstacles) const {
+std::int64_t problemSpecification::readPosition(problemFileReader &input, const char *what) const {
 
-  // Check if the problem settings are in the range.
+  const long long x = input.readInteger("the row", what);
+  const long long y = input.readInteger("the column", what);
 
-  if (heuristic_ < 0 || heuristic_ >= NUMBER_OF_HEURISTICS)
-    return false;
+  if (x < 0 || x >= number_of_rows_ || y < 0 || y >= number_of_colums_)
+    return -1;
 
-  if (number_of_rows_ < 0 || number_of_rows_ > MAX_ROW)
-    return false;
+  return y + std::int64_t(number_of_colums_) * x;
+}
 
-  if (number_of_colums_ < 0 || number_of_colums_ > MAX_COLUMN)
-    return false;
+void problemSpecification::loadBinary(std::shared_ptr<const MappedFile> file) {
+
+  TRACE_SCOPE("problemSpecification::loadBinary", "load");
+
+  const std::string &file_name = file->fileName();
+  if (file->size() < BINARY_MAP_HEADER_SIZE)
+    throw std::invalid_argument(file_name + ": The binary map ends before the end of its header.");
+
+  // We read the values one after the other, checking that the file has them.
+  std::size_t offset = sizeof(BINARY_MAP_MAGIC);
+  auto read = [&](const char *what) {
+    std::uint32_t value;
+    if (file->size() - offset < sizeof(value))
+      throw std::invalid_argument(file_name + ": The binary map ends before " + what + ".");
+    std::memcpy(&value, file->data() + offset, sizeof(value));
+    offset += sizeof(value);
+    return value;
+  };
+
+  if (read("the version") != BINARY_MAP_VERSION)
+    throw std::invalid_argument(file_name + ": Unknown version of the binary map.");
+
+  std::uint64_t byte_order;
+  std::memcpy(&byte_order, file->data() + offset, sizeof(byte_order));
+  if (byte_order != BINARY_MAP_BYTE_ORDER)
+    throw std::invalid_argument(file_name + ": The binary map was written with another byte order.");
+  offset += sizeof(byte_order);
+
+  const std::uint32_t heuristic_number = read("the heuristic");
+  if (heuristic_number >= NUMBER_OF_HEURISTICS)
+    throw std::out_of_range(file_name + ": The heuristic must be between 0 and " +
+                            std::to_string(NUMBER_OF_HEURISTICS - 1) + ".");
+  heuristic_ = static_cast<heuristicsName>(heuristic_number);
+
+  const std::uint32_t algorithm_number = read("the algorithm");
+  if (algorithm_number >= ALGORITHM_NAMES.size())
+    throw std::out_of_range(file_name + ": Unknown algorithm in the binary map.");
+  algorithm_ = static_cast<algorithmName>(algorithm_number);
+
+  const std::uint32_t rows = read("the number of rows")
+                    , columns = read("the number of columns");
+  if (rows > INT_MAX || columns > INT_MAX)
+    throw std::out_of_range(file_name + ": The size of the grid is too big.");
+  if (std::uint64_t(rows) * columns < 2)
+    throw std::out_of_range(file_name + ": The grid must have at least 2 cells, for the car and "
+                            "the final position.");
+  number_of_rows_ = rows;
+  number_of_colums_ = columns;
+
+  position car, final;
+  car.x = read("the car position");
+  car.y = read("the car position");
+  final.x = read("the final position");
+  final.y = read("the final position");
+  if (car.x >= rows || car.y >= columns || final.x >= rows || final.y >= columns)
+    throw std::out_of_range(file_name + ": The car or final position is outside the grid.");
+  car_position_ = vectorPos(car);
+  final_position_ = vectorPos(final);
+
+  // The grid is not read: its words are used from the mapped file, and the
+  // system only reads the tiles that the search uses.
+  file->advise(MappedFile::RANDOM_ACCESS);
+  obstacles_ = std::make_shared<OccupancyGrid>(file, offset, number_of_rows_, number_of_colums_);
+  offset += obstacles_->numWords() * sizeof(std::uint64_t);
+
+  const std::uint32_t number_of_changes = read("the number of obstacle changes");
+  for (std::uint32_t i = 0; i < number_of_changes; ++i) {
+    obstacleChange change;
+    change.pos.x = read("an obstacle change");
+    change.pos.y = read("an obstacle change");
+    change.add = read("an obstacle change") != 0;
+    if (change.pos.x >= rows || change.pos.y >= columns)
+      throw std::out_of_range(file_name + ": Invalid position of an obstacle change.");
+    obstacle_changes_.push_back(change);
+  }
 
-  if (car_position_ < 0 || car_position_ >= number_of_colums_ * number_of_rows_)
-    return false;
+  const std::uint32_t cache_length = read("the cache file");
+  if (file->size() - offset < cache_length)
+    throw std::invalid_argument(file_name + ": The binary map ends before the cache file.");
+  cache_file_.assign(file->data() + offset, cache_length);
+}
 
-  if (final_position_ < 0 || final_position_ >= number_of_colums_ * number_of_rows_)
-    return false;
+void problemSpecification::readDirectives(problemFileReader &input) {
 
-  if (number_of_obstacles < 0 || number_of_obstacles > (number_of_rows_ * number_of_colums_ - 2))
-    return false;
+  // Each directive is a keyword followed by its value.
+  while (!input.atEnd()) {
+
+    const std::string directive = input.readWord("a directive");
+
+    if (directive == "algorithm") {
+      const std::string name = input.readWord("the name of the algorithm");
+      try {
+        algorithm_ = algorithmFromName(name);
+      } catch (const std::invalid_argument &e) {
+        throw std::invalid_argument(input.where() + ": " + e.what());
+      }
+    } else if (directive == "seed") {
+      const long long seed = input.readInteger("the seed");
+      if (seed < 0)
+        throw std::out_of_range(input.where() + ": The seed can not be negative.");
+      seed_ = seed;
+    } else if (directive == "cache") {
+      cache_file_ = input.readWord("the cache file");
+    } else if (directive == "add-obstacle" || directive == "remove-obstacle") {
+      const std::int64_t change_pos = readPosition(input, ("the " + directive + " directive").c_str());
+      if (change_pos < 0)
+        throw std::out_of_range(input.where() + ": Invalid position in the " + directive + " directive.");
+
+      obstacleChange change;
+      change.pos = matrixPos(change_pos);
+      change.add = (directive == "add-obstacle");
+      obstacle_changes_.push_back(change);
+    } else {
+      throw std::invalid_argument(input.where() + ": Unknown directive " + directive + ".");
+    }
 
-  return true;
+  }
 }
 
-bool problemSpecification::positionIsIntroduced(int to_check_position) const {
+bool problemSpecification::positionIsIntroduced(std::int64_t to_check_position) const {
 
   // Check if position is on the vector range.
-  if (to_check_position < 0 || to_check_position >= number_of_colums_ * number_of_rows_)
+  if (to_check_position < 0 || to_check_position >= std::int64_t(number_of_colums_) * number_of_rows_)
       return false;
 
-  // Check if position is alredy in the vector
-  for (int i = 0; i < obstacle_positions_.size(); ++i) {
-    if (obstacle_positions_[i] == to_check_position)
-        return true;
-  }
+  // Check if position is alredy an obstacle.
+  const position matrix_pos = matrixPos(to_check_position);
+  if (obstacles_->isObstacle(matrix_pos.x, matrix_pos.y))
+      return true;
 
   // Check if position is the car position or the final position.
   if (to_check_position == car_position_ || to_check_position == final_position_)
@@ -169,53 +564,47 @@ bool problemSpecification::positionIsIntroduced(int to_check_position) const {
 }
 
 
-void problemSpecification::generateRandomObstacles(int obstacles_to_generate) {
-
-  // Vector that store all the posible obstacle positions.
-  std::vector<int> posible_obstacles;
+void problemSpecification::generateRandomObstacles(std::int64_t obstacles_to_generate) {
 
-  // filling the vector with all the positions.
-  for (int i = 0; i < number_of_rows_ * number_of_colums_; ++i)
-    posible_obstacles.push_back(i);
+  TRACE_SCOPE("problemSpecification::generateRandomObstacles", "load");
 
-  // erasing objets position previously introduced.
-  // Also we erase car and final position.
-  eraseIntroducedPositions(posible_obstacles);
+  // With the same seed the same obstacles are generated, see randomBelow.
+  std::mt19937 generator(seed_);
 
-  // We shuffle the vector.
+  const std::int64_t number_of_cells = std::int64_t(number_of_rows_) * number_of_colums_;
+  std::int64_t free_cells = number_of_cells - getNumberOfObstaces() -
+                            (car_position_ == final_position_ ? 1 : 2);
 
-  unsigned seed = std::chrono::system_clock::now().time_since_epoch().count();
-  std::shuffle(posible_obstacles.begin(), posible_obstacles.end(), std::default_random_engine(seed));
-
-  // We introudce in the vector the random obstacles.
-  for (int i = 0; i < obstacles_to_generate; ++i)
-    obstacle_positions_.push_back(posible_obstacles[i]);
-
-}
-
-void problemSpecification::eraseIntroducedPositions(std::vector<int> &posible_obstacles) const {
-
-  // We erase all the posible obstacles from the vector.
-  for (auto obstacle : obstacle_positions_) {
-
-    if (*posible_obstacles.end() == obstacle) {
-        posible_obstacles.pop_back();
-    } else {
-      posible_obstacles.erase(posible_obstacles.begin() + obstacle);
+  // When only a few of the free cells are needed, we pick random cells
+  // and skip the ones that are taken. The grid tells us in constant time.
+  if (obstacles_to_generate <= free_cells / 4) {
+    while (obstacles_to_generate > 0) {
+      const std::int64_t obstacle = randomBelow(generator, number_of_cells);
+      if (!positionIsIntroduced(obstacle)) {
+        const position obstacle_pos = matrixPos(obstacle);
+        obstacles_->setObstacle(obstacle_pos.x, obstacle_pos.y, true);
+        obstacles_to_generate--;
+      }
     }
-
-  }
-
-  if (*posible_obstacles.end() == car_position_) {
-    posible_obstacles.pop_back();
-  } else {
-    posible_obstacles.erase(posible_obstacles.begin() + car_position_);
+    return;
   }
 
-  if (*posible_obstacles.end() == final_position_) {
-    posible_obstacles.pop_back();
-  } else {
-    posible_obstacles.erase(posible_obstacles.begin() + final_position_);
+  // Otherwise we walk the free cells once, and each one is an obstacle with
+  // probability obstacles left / free cells left (selection sampling). Every
+  // set of cells is equally likely, and it needs no memory besides the grid,
+  // so it works on grids of any size.
+  for (int x = 0; x < number_of_rows_ && obstacles_to_generate > 0; ++x) {
+    for (int y = 0; y < number_of_colums_ && obstacles_to_generate > 0; ++y) {
+      const std::int64_t cell = std::int64_t(x) * number_of_colums_ + y;
+      if (obstacles_->isObstacle(x, y) || cell == car_position_ || cell == final_position_)
+        continue;
+
+      if (std::int64_t(randomBelow(generator, free_cells)) < obstacles_to_generate) {
+        obstacles_->setObstacle(x, y, true);
+        obstacles_to_generate--;
+      }
+      free_cells--;
+    }
   }
 
 }
@@ -0,0 +1,54 @@
+#include "ShortestPathAlgorithm.hpp"
+
+#include "AStar.hpp"
+#include "BidirectionalAStar.hpp"
+#include "DStarLite.hpp"
+#include "HierarchicalAStar.hpp"
+#include "JumpPointSearch.hpp"
+#include "TraceEvents.hpp"
+
+std::unique_ptr<ShortestPathAlgorithm> makeShortestPathAlgorithm(
+    algorithmName algorithm,
+    unsigned startX, unsigned startY,
+    unsigned endX, unsigned endY,
+    std::shared_ptr<const OccupancyGrid> obstacles,
+    unsigned h,
+    const std::string& cacheFile
+){
+    TRACE_SCOPE( "makeShortestPathAlgorithm", "search" );
+
+    switch( algorithm )
+    {
+        case JUMP_POINT_SEARCH:
+            return std::unique_ptr<ShortestPathAlgorithm>(
+                new JumpPointSearch( obstacles, startX, startY, endX, endY, h )
+            );
+
+        case BIDIRECTIONAL_A_STAR:
+            return std::unique_ptr<ShortestPathAlgorithm>(
+                new BidirectionalAStar( obstacles, startX, startY, endX, endY, h )
+            );
+
+        case D_STAR_LITE:
+            return std::unique_ptr<ShortestPathAlgorithm>(
+                new DStarLite( *obstacles, startX, startY, endX, endY, h )
+            );
+
+        case HIERARCHICAL_A_STAR:
+        {
+            auto graph = cacheFile.empty()
+                ? std::make_shared<const AbstractGraph>( *obstacles )
+                : AbstractGraph::loadOrBuild( cacheFile, *obstacles );
+
+            return std::unique_ptr<ShortestPathAlgorithm>(
+                new HierarchicalAStar( graph, obstacles, startX, startY, endX, endY, h )
+            );
+        }
+
+        case A_STAR:
+        default:
+            return std::unique_ptr<ShortestPathAlgorithm>(
+                new AStar( obstacles, startX, startY, endX, endY, h )
+            );
+    }
+}
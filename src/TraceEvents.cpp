@@ -0,0 +1,114 @@
+#include "TraceEvents.hpp"
+
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace
+{
+    struct Event
+    {
+        const char* name;
+        const char* category;
+        TraceRecorder::Clock::time_point start
+                                       , end;
+    };
+
+    // Each thread writes its own buffer, so recording an event does not lock.
+    // The buffers are kept until the end of the program, the threads that
+    // recorded them may have finished before stop()
+    struct ThreadBuffer
+    {
+        unsigned thread;  // Number of the thread in the trace
+        std::vector<Event> events;
+    };
+
+    std::mutex buffersMutex;
+    std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+    std::string traceFile;
+    TraceRecorder::Clock::time_point traceStart;
+
+    thread_local ThreadBuffer* threadBuffer = nullptr;
+
+    // Microseconds since the start of the trace, the unit of the trace events
+    double microseconds( TraceRecorder::Clock::time_point time )
+    {
+        return std::chrono::duration<double, std::micro>( time - traceStart ).count();
+    }
+}
+
+
+std::atomic<bool> TraceRecorder::recording_( false );
+
+
+void TraceRecorder::start( const std::string& fileName )
+{
+    std::lock_guard<std::mutex> lock( buffersMutex );
+    for( auto& buffer : buffers )
+        buffer->events.clear();
+
+    traceFile = fileName;
+    traceStart = Clock::now();
+    recording_.store( true );
+}
+
+
+bool TraceRecorder::stop()
+{
+    recording_.store( false );
+
+    std::lock_guard<std::mutex> lock( buffersMutex );
+    std::ofstream output( traceFile.c_str() );
+    output.setf( std::ios::fixed );
+    output.precision( 3 );
+
+    // Complete events ("ph": "X"), each with its start and its duration
+    output << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    const char* separator = "\n";
+    for( const auto& buffer : buffers )
+    {
+        for( const Event& event : buffer->events )
+        {
+            output << separator
+                   << "{\"name\":\"" << event.name << "\",\"cat\":\"" << event.category
+                   << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->thread
+                   << ",\"ts\":" << microseconds( event.start )
+                   << ",\"dur\":" << microseconds( event.end ) - microseconds( event.start ) << '}';
+            separator = ",\n";
+        }
+        buffer->events.clear();
+    }
+    output << "\n]}\n";
+
+    return bool( output.flush() );
+}
+
+
+TraceSession::TraceSession( const std::string& fileName ):
+  fileName_( fileName )
+{
+    if( !fileName_.empty() )
+        TraceRecorder::start( fileName_ );
+}
+
+
+TraceSession::~TraceSession()
+{
+    if( !fileName_.empty()  &&  !TraceRecorder::stop() )
+        std::cerr << "Cannot write the trace file " << fileName_ << '\n';
+}
+
+
+void TraceRecorder::record( const char* name, const char* category, Clock::time_point start, Clock::time_point end )
+{
+    if( threadBuffer == nullptr )
+    {
+        std::lock_guard<std::mutex> lock( buffersMutex );
+        buffers.emplace_back( new ThreadBuffer{ unsigned( buffers.size() + 1 ), {} } );
+        threadBuffer = buffers.back().get();
+    }
+
+    threadBuffer->events.push_back( { name, category, start, end } );
+}
@@ -0,0 +1,471 @@
+// Benchmark of the search algorithm. It runs AStar over every problem file in
+// test/*.config and over bigger maps generated with fixed seeds from the
+// small, medium and big size configurations. Only the search is timed.
+//
+// With --batch-queries it also measures the throughput of the batch engine
+// with 1, 2, 4... workers, up to the number of hardware threads.
+//
+// With --compare-layouts it also runs AStar over the generated maps with each
+// of the cell layouts of GridMap, to see when Z-order beats row-major.
+//
+// Usage: shortest-path-bench [--algorithm name] [--repetitions N] [--batch-queries N]
+//                            [--compare-layouts] [--output file.json] [--baseline file.json]
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <exception>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <glob.h>
+#include <sys/resource.h>
+
+#include "AStar.hpp"
+#include "BatchQueryEngine.hpp"
+#include "ProblemSpecification.hpp"
+#include "ShortestPathAlgorithm.hpp"
+
+
+// A map to solve. It is built from a problem file or generated.
+struct BenchCase
+{
+    std::string name;
+    unsigned rows, columns;
+    position start, goal;
+    std::shared_ptr<const OccupancyGrid> obstacles;
+    unsigned heuristic;
+};
+
+// Results of running a case several times
+struct BenchResult
+{
+    std::string name;
+    unsigned rows, columns;
+    long expansions;
+    long pathLength;               // Number of moves, or -1 if there is no path
+    std::vector<double> latencies; // Milliseconds of each repetition, sorted
+    long peakMemoryKb;             // Peak resident memory of the process after the case
+
+    // Nearest rank percentile of the latencies
+    double percentile( double p )const
+    {
+        std::size_t rank = (std::size_t)std::ceil( p / 100.0 * latencies.size() );
+        return latencies[ std::max<std::size_t>( rank, 1 ) - 1 ];
+    }
+};
+
+// Sizes of the maps generated from each of the size configurations
+const std::vector<unsigned> SCALED_SIZES = { 250, 500, 1000 };
+const std::vector<std::string> SCALED_TEMPLATES = {
+    "test/small_size.config",
+    "test/medium_size.config",
+    "test/big_size.config"
+};
+const unsigned BASE_SEED = 20171003;
+
+
+BenchCase caseFromProblem( const std::string& name, const problemSpecification& problem )
+{
+    return {
+        name,
+        (unsigned)problem.rows(), (unsigned)problem.columns(),
+        problem.car_position(), problem.final_position(),
+        problem.obstacles(),
+        (unsigned)problem.heuristic()
+    };
+}
+
+// Generates a size x size map with the same obstacle density, heuristic and
+// relative start and goal positions as the given problem
+BenchCase scaledCase( const std::string& templateName, const problemSpecification& problem,
+                      unsigned size, unsigned seed )
+{
+    const double density = (double)problem.getNumberOfObstaces() / ( (double)problem.rows() * problem.columns() );
+
+    // Keep the start and goal in the same relative place of the map
+    auto scale = []( unsigned pos, int dimension, unsigned size ){
+        return (unsigned)( (unsigned long)pos * size / dimension );
+    };
+
+    BenchCase result;
+    result.name = templateName + "@" + std::to_string(size) + "x" + std::to_string(size);
+    result.rows = result.columns = size;
+    result.start = { scale( problem.car_position().x, problem.rows(), size ),
+                     scale( problem.car_position().y, problem.columns(), size ) };
+    result.goal  = { scale( problem.final_position().x, problem.rows(), size ),
+                     scale( problem.final_position().y, problem.columns(), size ) };
+    result.heuristic = problem.heuristic();
+    auto obstacles = std::make_shared<OccupancyGrid>( size, size );
+
+    // Partial Fisher-Yates shuffle of the free cells to choose the obstacles
+    std::vector<unsigned> cells;
+    cells.reserve( size * size );
+    for( unsigned i = 0; i < size * size; ++i )
+        if( i != result.start.x * size + result.start.y  &&  i != result.goal.x * size + result.goal.y )
+            cells.push_back( i );
+
+    // randomBelow draws the same numbers with every library, so the maps
+    // compared with a baseline are the same
+    std::mt19937 generator( seed );
+    const std::size_t numberOfObstacles = (std::size_t)( density * cells.size() );
+    for( std::size_t i = 0; i < numberOfObstacles; ++i )
+    {
+        std::swap( cells[i], cells[ i + randomBelow( generator, cells.size() - i ) ] );
+        obstacles->setObstacle( cells[i] / size, cells[i] % size, true );
+    }
+
+    result.obstacles = obstacles;
+    return result;
+}
+
+long peakMemoryKb()
+{
+    struct rusage usage;
+    getrusage( RUSAGE_SELF, &usage );
+    return usage.ru_maxrss;
+}
+
+BenchResult runCase( const BenchCase& benchCase, algorithmName algorithm, int repetitions )
+{
+    BenchResult result;
+    result.name = benchCase.name;
+    result.rows = benchCase.rows;
+    result.columns = benchCase.columns;
+
+    for( int i = 0; i < repetitions; ++i )
+    {
+        const auto start = std::chrono::steady_clock::now();
+
+        auto shortestPathFinder = makeShortestPathAlgorithm(
+            algorithm,
+            benchCase.start.x, benchCase.start.y,
+            benchCase.goal.x, benchCase.goal.y,
+            benchCase.obstacles,
+            benchCase.heuristic
+        );
+
+        long expansions = 0;
+        while( !shortestPathFinder->nextIteration( false ) )
+            ++expansions;
+
+        const std::chrono::duration<double, std::milli> latency =
+            std::chrono::steady_clock::now() - start;
+
+        result.latencies.push_back( latency.count() );
+        result.expansions = expansions;
+        result.pathLength = (long)shortestPathFinder->getShortestPath().size() - 1;
+    }
+
+    std::sort( result.latencies.begin(), result.latencies.end() );
+    result.peakMemoryKb = peakMemoryKb();
+
+    return result;
+}
+
+// Solves random queries with fixed seeds on the map of benchCase with the batch
+// engine. Each repetition measures the time of the whole batch
+BenchResult runBatch( const BenchCase& benchCase, unsigned numberOfQueries, unsigned numberOfWorkers, int repetitions )
+{
+    auto map = std::make_shared<const GridMap>( benchCase.obstacles );
+
+    // Random free cells as start and goal of each query
+    std::mt19937 generator( BASE_SEED );
+    auto randomFreeCell = [&](){
+        GridPos pos;
+        do
+            pos = { unsigned( randomBelow( generator, benchCase.rows ) ),
+                    unsigned( randomBelow( generator, benchCase.columns ) ) };
+        while( map->obstacles().isObstacle( pos.x, pos.y ) );
+        return pos;
+    };
+
+    std::vector<PathQuery> queries( numberOfQueries );
+    for( auto& query : queries )
+        query = { randomFreeCell(), randomFreeCell() };
+
+    BatchQueryEngine engine( map, benchCase.heuristic, numberOfWorkers );
+
+    BenchResult result;
+    result.name = "batch:" + benchCase.name + "@" + std::to_string(numberOfWorkers) + "workers";
+    result.rows = benchCase.rows;
+    result.columns = benchCase.columns;
+    result.pathLength = -1;
+
+    for( int i = 0; i < repetitions; ++i )
+    {
+        const auto start = std::chrono::steady_clock::now();
+        const std::vector<PathQueryResult> solved = engine.solve( queries );
+        const std::chrono::duration<double, std::milli> latency =
+            std::chrono::steady_clock::now() - start;
+
+        result.latencies.push_back( latency.count() );
+        result.expansions = 0;
+        for( const auto& r : solved )
+            result.expansions += r.expansions;
+    }
+
+    std::sort( result.latencies.begin(), result.latencies.end() );
+    result.peakMemoryKb = peakMemoryKb();
+
+    return result;
+}
+
+// Solves benchCase with AStar on a GridMap with the given layout. The map is
+// built in each repetition, like in runCase
+BenchResult runLayout( const BenchCase& benchCase, CellLayout layout, int repetitions )
+{
+    BenchResult result;
+    result.name = "layout:" + benchCase.name + ( layout == Z_ORDER_LAYOUT ? "@z-order" : "@row-major" );
+    result.rows = benchCase.rows;
+    result.columns = benchCase.columns;
+
+    for( int i = 0; i < repetitions; ++i )
+    {
+        const auto start = std::chrono::steady_clock::now();
+
+        AStar shortestPathFinder(
+            std::make_shared<const GridMap>( benchCase.obstacles, layout ),
+            benchCase.start.x, benchCase.start.y,
+            benchCase.goal.x, benchCase.goal.y,
+            benchCase.heuristic
+        );
+
+        long expansions = 0;
+        while( !shortestPathFinder.nextIteration( false ) )
+            ++expansions;
+
+        const std::chrono::duration<double, std::milli> latency =
+            std::chrono::steady_clock::now() - start;
+
+        result.latencies.push_back( latency.count() );
+        result.expansions = expansions;
+        result.pathLength = (long)shortestPathFinder.getShortestPath().size() - 1;
+    }
+
+    std::sort( result.latencies.begin(), result.latencies.end() );
+    result.peakMemoryKb = peakMemoryKb();
+
+    return result;
+}
+
+void printResult( const BenchResult& r, const std::map<std::string, double>& baseline )
+{
+    const double median = r.percentile(50);
+
+    std::cout << std::left << std::setw(48) << r.name
+              << std::right << std::setw(12) << r.expansions
+              << std::setw(12) << std::fixed << std::setprecision(3) << median
+              << std::setw(12) << r.percentile(99)
+              << std::setw(12) << std::setprecision(1)
+              << ( r.expansions > 0 ? median * 1e6 / r.expansions : 0 )
+              << std::setw(12) << r.peakMemoryKb;
+
+    // Ratio of the current median with respect to the baseline one
+    auto old = baseline.find( r.name );
+    if( old != baseline.end()  &&  old->second > 0 )
+        std::cout << "  " << std::setprecision(2) << median / old->second << "x";
+
+    std::cout << '\n';
+}
+
+// Reads the median latency of each case from a file written by writeJson
+std::map<std::string, double> readBaseline( const std::string& fileName )
+{
+    std::ifstream file( fileName.c_str() );
+    if( !file.is_open() )
+        throw std::invalid_argument( "Cannot open baseline file " + fileName );
+
+    std::map<std::string, double> medians;
+    const std::string nameKey = "\"name\": \""
+                    , medianKey = "\"p50_ms\": ";
+
+    // writeJson puts every case in its own line
+    std::string line;
+    while( std::getline( file, line ) )
+    {
+        std::size_t namePos = line.find( nameKey )
+                  , medianPos = line.find( medianKey );
+        if( namePos == std::string::npos  ||  medianPos == std::string::npos )
+            continue;
+
+        namePos += nameKey.size();
+        const std::string name = line.substr( namePos, line.find( '"', namePos ) - namePos );
+        medians[name] = std::atof( line.c_str() + medianPos + medianKey.size() );
+    }
+
+    return medians;
+}
+
+void writeJson( std::ostream& out, const std::vector<BenchResult>& results,
+                algorithmName algorithm, int repetitions )
+{
+    out << "{\n  \"algorithm\": \"" << ALGORITHM_NAMES[algorithm] << "\""
+        << ",\n  \"repetitions\": " << repetitions << ",\n  \"cases\": [\n";
+
+    for( std::size_t i = 0; i < results.size(); ++i )
+    {
+        const auto& r = results[i];
+        const double median = r.percentile(50);
+
+        out << "    {\"name\": \"" << r.name << "\""
+            << ", \"rows\": " << r.rows
+            << ", \"columns\": " << r.columns
+            << ", \"path_length\": " << r.pathLength
+            << ", \"expansions\": " << r.expansions
+            << ", \"expansions_per_sec\": " << ( median > 0 ? r.expansions / median * 1000.0 : 0 )
+            << ", \"ns_per_expansion\": " << ( r.expansions > 0 ? median * 1e6 / r.expansions : 0 )
+            << ", \"p50_ms\": " << median
+            << ", \"p90_ms\": " << r.percentile(90)
+            << ", \"p99_ms\": " << r.percentile(99)
+            << ", \"peak_memory_kb\": " << r.peakMemoryKb
+            << "}" << ( i + 1 < results.size() ? "," : "" ) << '\n';
+    }
+
+    out << "  ]\n}\n";
+}
+
+std::vector<std::string> corpusFiles()
+{
+    std::vector<std::string> files;
+
+    glob_t globResult;
+    if( glob( "test/*.config", 0, nullptr, &globResult ) == 0 )
+        for( std::size_t i = 0; i < globResult.gl_pathc; ++i )
+            files.push_back( globResult.gl_pathv[i] );
+    globfree( &globResult );
+
+    return files;
+}
+
+
+int main( int argc, char *argv[] )
+{
+    int repetitions = 5;
+    unsigned batchQueries = 0;
+    bool compareLayouts = false;
+    std::string algorithmArg = ALGORITHM_NAMES[A_STAR]
+              , outputFile
+              , baselineFile;
+
+    for( int i = 1; i < argc; ++i )
+    {
+        const std::string arg = argv[i];
+        if( arg == "--algorithm"  &&  i + 1 < argc )
+            algorithmArg = argv[++i];
+        else if( arg == "--repetitions"  &&  i + 1 < argc )
+            repetitions = std::max( 1, std::atoi( argv[++i] ) );
+        else if( arg == "--batch-queries"  &&  i + 1 < argc )
+            batchQueries = std::atoi( argv[++i] );
+        else if( arg == "--compare-layouts" )
+            compareLayouts = true;
+        else if( arg == "--output"  &&  i + 1 < argc )
+            outputFile = argv[++i];
+        else if( arg == "--baseline"  &&  i + 1 < argc )
+            baselineFile = argv[++i];
+        else
+        {
+            std::cerr << "Usage: " << argv[0]
+                      << " [--algorithm name] [--repetitions N] [--batch-queries N]"
+                      << " [--compare-layouts] [--output file.json] [--baseline file.json]\n";
+            return 1;
+        }
+    }
+
+    try
+    {
+        const algorithmName algorithm = algorithmFromName( algorithmArg );
+        std::vector<BenchCase> cases;
+
+        // Every problem file of the corpus. The ones that cannot be loaded are skipped
+        for( auto fileName : corpusFiles() )
+        {
+            try
+            {
+                problemSpecification problem( fileName );
+                cases.push_back( caseFromProblem( fileName, problem ) );
+            }
+            catch( const std::exception& e )
+            {
+                std::cerr << "Skipping " << fileName << ": " << e.what() << '\n';
+            }
+        }
+
+        // Scaled maps with fixed seeds, so every run solves the same maps
+        unsigned seed = BASE_SEED;
+        for( auto templateName : SCALED_TEMPLATES )
+        {
+            problemSpecification problem( templateName );
+            for( auto size : SCALED_SIZES )
+                cases.push_back( scaledCase( templateName, problem, size, seed++ ) );
+        }
+
+        const std::map<std::string, double> baseline =
+            baselineFile.empty() ? std::map<std::string, double>() : readBaseline( baselineFile );
+
+        std::vector<BenchResult> results;
+
+        std::cout << std::left << std::setw(48) << "case"
+                  << std::right << std::setw(12) << "expansions"
+                  << std::setw(12) << "p50_ms" << std::setw(12) << "p99_ms"
+                  << std::setw(12) << "ns/exp" << std::setw(12) << "peak_kb"
+                  << ( baseline.empty() ? "" : "  vs baseline" ) << '\n';
+
+        for( const auto& benchCase : cases )
+        {
+            results.push_back( runCase( benchCase, algorithm, repetitions ) );
+            printResult( results.back(), baseline );
+        }
+
+        // The generated maps are the last cases
+        if( compareLayouts )
+        {
+            const std::size_t numberOfScaled = SCALED_TEMPLATES.size() * SCALED_SIZES.size();
+            for( std::size_t i = cases.size() - numberOfScaled; i < cases.size(); ++i )
+                for( CellLayout layout : { ROW_MAJOR_LAYOUT, Z_ORDER_LAYOUT } )
+                {
+                    results.push_back( runLayout( cases[i], layout, repetitions ) );
+                    printResult( results.back(), baseline );
+                }
+        }
+
+        // Throughput of the batch engine on the biggest generated map
+        if( batchQueries > 0 )
+        {
+            std::vector<unsigned> workers = { 1 };
+            while( workers.back() * 2 <= std::max( 1u, std::thread::hardware_concurrency() ) )
+                workers.push_back( workers.back() * 2 );
+
+            for( auto numberOfWorkers : workers )
+            {
+                results.push_back( runBatch( cases.back(), batchQueries, numberOfWorkers, repetitions ) );
+                printResult( results.back(), baseline );
+            }
+        }
+
+        if( !outputFile.empty() )
+        {
+            std::ofstream out( outputFile.c_str() );
+            if( !out.is_open() )
+                throw std::invalid_argument( "Cannot open output file " + outputFile );
+
+            writeJson( out, results, algorithm, repetitions );
+        }
+    }
+    catch( const std::exception& e )
+    {
+        std::cerr << e.what() << '\n';
+        return 1;
+    }
+
+    return 0;
+}
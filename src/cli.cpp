@@ -0,0 +1,283 @@
+// Headless entry point of the project. It solves the given problem files
+// without opening any window and prints one tab separated line per file,
+// so it can be used in batch servers and to time the search algorithm.
+//
+// With --queries it solves instead many start and goal pairs on the map of a
+// single problem file, using a pool of threads. --layout z-order keeps the
+// map of the queries in Z-order instead of by rows, see GridMap.hpp.
+//
+// If a problem file has obstacle changes, the path is searched again after
+// each one and a line "file#i" is printed for the i-th change.
+//
+// The columns after wall_time_ms are the statistics of the search, see
+// SearchStatistics.hpp. D* Lite repairs its search after a change, so its
+// statistics add up over the lines of a file.
+//
+// With --trace the time spent loading the problems and searching is written
+// to a file as Chrome trace events, see TraceEvents.hpp.
+
+#include <chrono>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "BatchQueryEngine.hpp"
+#include "ProblemSpecification.hpp"
+#include "ShortestPathAlgorithm.hpp"
+#include "TraceEvents.hpp"
+
+
+// Reads the queries of a file, one "startX startY goalX goalY" per line
+std::vector<PathQuery> readQueries( const std::string& fileName )
+{
+    std::ifstream file( fileName.c_str() );
+    if( !file.is_open() )
+        throw std::invalid_argument( "Cannot open queries file " + fileName );
+
+    std::vector<PathQuery> queries;
+    PathQuery query;
+    while( file >> query.start.x >> query.start.y >> query.goal.x >> query.goal.y )
+        queries.push_back( query );
+
+    if( !file.eof() )
+        throw std::invalid_argument( "Invalid query in " + fileName );
+
+    return queries;
+}
+
+// Runs the search until it finishes and prints its line of the results table
+void runSearch( ShortestPathAlgorithm& shortestPathFinder, const std::string& name,
+                algorithmName algorithm, std::chrono::steady_clock::time_point start )
+{
+    TRACE_SCOPE( "runSearch", "search" );
+
+    // Each iteration that does not finish the search expands one node
+    long expansions = 0;
+    while( !shortestPathFinder.nextIteration( false ) )
+        ++expansions;
+
+    const std::chrono::duration<double, std::milli> wallTime =
+        std::chrono::steady_clock::now() - start;
+
+    // The path length is the number of moves, so the start cell is not counted
+    const auto& path = shortestPathFinder.getShortestPath();
+    const SearchStatistics& statistics = shortestPathFinder.statistics();
+    std::cout << name << '\t'
+              << ALGORITHM_NAMES[ algorithm ] << '\t'
+              << ( path.empty() ? "no_path" : "solved" ) << '\t'
+              << ( path.empty() ? 0 : path.size() - 1 ) << '\t'
+              << expansions << '\t'
+              << wallTime.count() << '\t'
+              << statistics.generations << '\t'
+              << statistics.duplicates << '\t'
+              << statistics.reopened << '\t'
+              << statistics.heuristicCalls << '\t'
+              << statistics.peakOpen << '\t'
+              << statistics.peakClosed << '\t'
+              << statistics.bytesAllocated << '\t'
+              << statistics.setupMs << '\t'
+              << statistics.searchMs << '\t'
+              << statistics.pathMs << '\n';
+}
+
+// Solves the queries on the map of the problem and prints one line per query
+int solveQueries( std::string file_name, const std::string& queriesFile, unsigned threads, CellLayout layout )
+{
+    problemSpecification problem( file_name );
+    const std::vector<PathQuery> queries = readQueries( queriesFile );
+
+    BatchQueryEngine engine(
+        std::make_shared<const GridMap>( problem.obstacles(), layout ),
+        problem.heuristic(),
+        threads
+    );
+
+    const auto start = std::chrono::steady_clock::now();
+    const std::vector<PathQueryResult> results = engine.solve( queries );
+    const std::chrono::duration<double, std::milli> wallTime =
+        std::chrono::steady_clock::now() - start;
+
+    int exitStatus = 0;
+    std::cout << "query\tstatus\tpath_length\texpansions\n";
+    for( std::size_t i = 0; i < results.size(); ++i )
+    {
+        if( !results[i].error.empty() )
+        {
+            std::cerr << "query " << i << ": " << results[i].error << '\n';
+            std::cout << i << "\terror\t0\t0\n";
+            exitStatus = 1;
+            continue;
+        }
+
+        const auto& path = results[i].path;
+        std::cout << i << '\t'
+                  << ( path.empty() ? "no_path" : "solved" ) << '\t'
+                  << ( path.empty() ? 0 : path.size() - 1 ) << '\t'
+                  << results[i].expansions << '\n';
+    }
+
+    std::cerr << results.size() << " queries solved by " << engine.numberOfWorkers()
+              << " workers in " << wallTime.count() << " ms\n";
+
+    return exitStatus;
+}
+
+
+int main( int argc, char *argv[] )
+{
+    int firstFile = 1;
+    bool overrideAlgorithm = false;
+    algorithmName algorithm = A_STAR;
+    std::string queriesFile
+              , convertFile
+              , traceFile;
+    unsigned threads = 0;
+    CellLayout layout = ROW_MAJOR_LAYOUT;
+
+    // Options go before the problem files
+    try
+    {
+        for( ; firstFile + 1 < argc  &&  std::string( argv[firstFile] ).compare( 0, 2, "--" ) == 0; firstFile += 2 )
+        {
+            const std::string option = argv[firstFile]
+                            , value = argv[firstFile + 1];
+
+            // The algorithm of the problem files can be overridden from the command line
+            if( option == "--algorithm" )
+            {
+                algorithm = algorithmFromName( value );
+                overrideAlgorithm = true;
+            }
+            else if( option == "--queries" )
+                queriesFile = value;
+            else if( option == "--convert" )
+                convertFile = value;
+            else if( option == "--trace" )
+                traceFile = value;
+            else if( option == "--threads" )
+            {
+                // Only digits, and few enough of them to fit in an unsigned
+                if( value.empty()  ||  value.size() > 9  ||  value.find_first_not_of( "0123456789" ) != std::string::npos )
+                    throw std::invalid_argument( "The number of threads must be a positive integer, not " + value );
+                threads = std::stoul( value );
+                if( threads == 0 )
+                    throw std::invalid_argument( "The number of threads must be a positive integer, not " + value );
+            }
+            else if( option == "--layout"  &&  ( value == "row-major"  ||  value == "z-order" ) )
+                layout = ( value == "z-order" ) ? Z_ORDER_LAYOUT : ROW_MAJOR_LAYOUT;
+            else
+                throw std::invalid_argument( "Unknown option " + option );
+        }
+    }
+    catch( const std::exception& e )
+    {
+        std::cerr << e.what() << '\n';
+        return 1;
+    }
+
+    if( firstFile >= argc  ||  ( ( !queriesFile.empty()  ||  !convertFile.empty() )  &&  firstFile + 1 != argc ) )
+    {
+        std::cerr << "Usage: " << argv[0] << " [--trace trace-file] [--algorithm name] problem-file [problem-file ...]\n"
+                  << "       " << argv[0] << " [--trace trace-file] --queries queries-file [--threads N] [--layout row-major|z-order] problem-file\n"
+                  << "       " << argv[0] << " --convert binary-map-file problem-file\n";
+        return 1;
+    }
+
+    // Written when main returns
+    TraceSession trace( traceFile );
+
+    // The problem file is written as a binary map, with its random obstacles already placed
+    if( !convertFile.empty() )
+    {
+        try
+        {
+            std::string file_name = argv[firstFile];
+            problemSpecification problem( file_name );
+            if( !problem.saveBinary( convertFile ) )
+                throw std::runtime_error( "Cannot write the binary map " + convertFile );
+            return 0;
+        }
+        catch( const std::exception& e )
+        {
+            std::cerr << e.what() << '\n';
+            return 1;
+        }
+    }
+
+    if( !queriesFile.empty() )
+    {
+        try
+        {
+            return solveQueries( argv[firstFile], queriesFile, threads, layout );
+        }
+        catch( const std::exception& e )
+        {
+            std::cerr << e.what() << '\n';
+            return 1;
+        }
+    }
+
+    int exitStatus = 0;
+
+    // Header of the results table
+    std::cout << "file\talgorithm\tstatus\tpath_length\texpansions\twall_time_ms"
+                 "\tgenerations\tduplicates\treopened\theuristic_calls\tpeak_open\tpeak_closed"
+                 "\tbytes\tsetup_ms\tsearch_ms\tpath_ms\n";
+
+    for( int i = firstFile; i < argc; ++i )
+    {
+        std::string file_name = argv[i];
+
+        try
+        {
+            problemSpecification problem( file_name );
+            const algorithmName problemAlgorithm = overrideAlgorithm ? algorithm : problem.algorithm();
+            std::shared_ptr<const OccupancyGrid> obstacles = problem.obstacles();
+
+            auto makeSearch = [&](){
+                return makeShortestPathAlgorithm(
+                    problemAlgorithm,
+                    problem.car_position().x, problem.car_position().y,
+                    problem.final_position().x, problem.final_position().y,
+                    obstacles,
+                    problem.heuristic(),
+                    problem.cacheFile()
+                );
+            };
+
+            // Only the search is timed, the problem loading is left out
+            auto start = std::chrono::steady_clock::now();
+            auto shortestPathFinder = makeSearch();
+            runSearch( *shortestPathFinder, file_name, problemAlgorithm, start );
+
+            // The algorithms that cannot repair their search start a new one after each change
+            const auto& changes = problem.obstacleChanges();
+            for( std::size_t change = 0; change < changes.size(); ++change )
+            {
+                // The shared map is not modified, the next searches get a changed copy
+                const position& pos = changes[change].pos;
+                auto changedObstacles = std::make_shared<OccupancyGrid>( *obstacles );
+                changedObstacles->setObstacle( pos.x, pos.y, changes[change].add );
+                obstacles = changedObstacles;
+
+                start = std::chrono::steady_clock::now();
+                if( !shortestPathFinder->changeObstacle( pos.x, pos.y, changes[change].add ) )
+                    shortestPathFinder = makeSearch();
+
+                runSearch( *shortestPathFinder, file_name + '#' + std::to_string( change + 1 ), problemAlgorithm, start );
+            }
+        }
+        catch( const std::exception& e )
+        {
+            std::cerr << file_name << ": " << e.what() << '\n';
+            std::cout << file_name << "\t-\terror\t0\t0\t0\t0\t0\t0\t0\t0\t0\t0\t0\t0\t0\n";
+            exitStatus = 1;
+        }
+    }
+
+    return exitStatus;
+}
@@ -2,21 +2,28 @@
 #include <stdexcept> // std::invalid_argument
 #include <fstream>
 #include <vector>
-#include <time.h>
 
 #include "Button.hpp"
 #include "ClassGraphicGrid.hpp"
 #include "GridCamera.hpp"
 #include "ProblemSpecification.hpp"
-#include "AStar.hpp"
+#include "ShortestPathAlgorithm.hpp"
+#include "TraceEvents.hpp"
 
 
 // This is defined below main
 void updateGridCameraFromKeyboardInput( GridCamera& camera );
 
+// Number of cells from which the grid is drawn from the states of its cells
+const std::size_t CELL_STATES_GRID_SIZE = 250000;
+
 
 int main( int argc, char *argv[] )
 {
+    // The second argument is the file where the trace of the program is written
+    // when it ends, see TraceEvents.hpp
+    TraceSession trace(argc >= 3 ? argv[2] : "");
+
     sf::RenderWindow window(
         sf::VideoMode::getDesktopMode(),
         "Shortest path"
@@ -34,6 +41,11 @@ int main( int argc, char *argv[] )
 
         problemSpecification new_problem(file_name);
 
+        // Big grids keep a byte per cell instead of the vertices of its sprite, see GraphicGrid
+        const GraphicGrid::RenderMode renderMode =
+            (std::size_t)new_problem.rows() * new_problem.columns() > CELL_STATES_GRID_SIZE
+                ? GraphicGrid::CELL_STATES : GraphicGrid::SPRITE_CHUNKS;
+
         // Create grid
         auto grid = GraphicGrid::init(
             { 100, 100 },                 // Grid top left position
@@ -45,18 +57,18 @@ int main( int argc, char *argv[] )
             new_problem.columns(),
             "sprites/sprite-sheet.png",   // Location of the sprite sheet
             { 32, 32 },                   // The size of a single sprite image in the sheet
-            { 0, 0 }                      // The position of the default sprite image in the sheet
+            { 0, 0 },                     // The position of the default sprite image in the sheet
+            renderMode
         );
 
         // Show obstacles in grid
-        // And store them to pass to the shortest path algorithm
-        std::vector<bool> obstacles( grid.numCols() * grid.numRows() );
-        for( int i = 0; i < new_problem.getNumberOfObstaces(); ++i )
+        const auto obstacleGrid = new_problem.obstacles();
         {
-          const auto& pos = new_problem.getObstacle(i);
-          grid.changeCellTexture( {(unsigned)pos.x, (unsigned)pos.y}, {2,0} );
-
-          obstacles[ pos.x * grid.numCols() + pos.y ] = true;
+          TRACE_SCOPE( "main::paintObstacles", "render" );
+          for( unsigned x = 0; x < obstacleGrid->numRows(); ++x )
+            for( unsigned y = 0; y < obstacleGrid->numCols(); ++y )
+              if( obstacleGrid->isObstacle(x, y) )
+                grid.changeCellTexture( {x, y}, {2,0} );
         }
 
         // Set car in grid
@@ -77,12 +89,17 @@ int main( int argc, char *argv[] )
           {0, 1}
         );
 
-        AStar shortestPathFinder(
-            new_problem.rows(), new_problem.columns(),
+        // The user can add and remove obstacles with the right mouse button. The
+        // search keeps its own map, this copy is only used to paint the cells
+        OccupancyGrid obstacles = *obstacleGrid;
+
+        auto shortestPathFinder = makeShortestPathAlgorithm(
+            new_problem.algorithm(),    // Search algorithm to use
             new_problem.car_position().x, new_problem.car_position().y,
             new_problem.final_position().x, new_problem.final_position().y,
-            obstacles,
-            new_problem.heuristic() // Heuristic function to use
+            obstacleGrid,
+            new_problem.heuristic(), // Heuristic function to use
+            new_problem.cacheFile()
         );
 
         // This object will allow us to zoom and move the "camera" that shows the grid
@@ -119,10 +136,11 @@ int main( int argc, char *argv[] )
            , algorithmHadFinished = false;
 
         int number_of_steps = 0;
-        clock_t timer;
 
         while (window.isOpen())
         {
+            TRACE_SCOPE( "main::frame", "frame" );
+
             // Event loop
             sf::Event event;
             while (window.pollEvent(event))
@@ -147,6 +165,40 @@ int main( int argc, char *argv[] )
                         break;
 
                     case sf::Event::MouseButtonPressed:
+                      // Right click on a cell adds or removes its obstacle, and the
+                      // search continues from the current state to repair the path
+                      if (event.mouseButton.button == sf::Mouse::Right) {
+                        sf::Vector2u cell;
+                        const sf::Vector2f point = window.mapPixelToCoords(
+                            {event.mouseButton.x, event.mouseButton.y}, gridCamera.getView());
+
+                        auto isEnd = [&](){
+                          return (cell.x == new_problem.car_position().x && cell.y == new_problem.car_position().y) ||
+                                 (cell.x == new_problem.final_position().x && cell.y == new_problem.final_position().y);
+                        };
+
+                        if (grid.cellAt(point, cell) && !isEnd()) {
+                          const bool isObstacle = !obstacles.isObstacle(cell.x, cell.y);
+                          const std::vector<GridPos> oldPath = shortestPathFinder->getShortestPath();
+
+                          if (shortestPathFinder->changeObstacle(cell.x, cell.y, isObstacle)) {
+                            obstacles.setObstacle(cell.x, cell.y, isObstacle);
+
+                            // The old path is shown as explored cells again
+                            for( const auto& pos : oldPath )
+                              grid.changeCellTexture( {pos.x, pos.y} , {2,1} );
+
+                            grid.changeCellTexture(cell, isObstacle ? sf::Vector2u(2,0) : sf::Vector2u(0,0));
+
+                            algorithmHadFinished = false;
+                          } else {
+                            std::clog << ALGORITHM_NAMES[new_problem.algorithm()]
+                                      << " cannot change the obstacles, use dstar-lite" << std::endl;
+                          }
+                        }
+                        break;
+                      }
+
                       // Check if user clicked a button
                       if (nextButton.isClicked(sf::Mouse::getPosition(window))) {
                         std::clog << "Next Button pressed" << std::endl;
@@ -155,7 +207,6 @@ int main( int argc, char *argv[] )
                       if (runButton.isClicked(sf::Mouse::getPosition(window))) {
                         std::clog << "Run Button pressed" << std::endl;
                           nonInteractiveMode = true;
-                          timer = clock();
                       }
                       // If the mouse is clicked in the grid section, lets indicate
                       // that we have to update the camera relative to the mouse position.
@@ -204,16 +255,19 @@ int main( int argc, char *argv[] )
             // Run algorithm
             if( !algorithmHadFinished && (runAlgorithmOnce || nonInteractiveMode) )
             {
-                if( !shortestPathFinder.nextIteration() )
+                TRACE_SCOPE( "main::searchStep", "frame" );
+
+                if( !shortestPathFinder->nextIteration() )
                 {
 
                     number_of_steps++;
 
 
                       // Change the texture into yellow and green path.
-                      grid.changeCellTexture( shortestPathFinder.lastAdditionToClose , {2,1} );
-                      for( const auto& pos : shortestPathFinder.lastAdditionsToOpen )
-                          grid.changeCellTexture( pos , {1,1} );
+                      const auto& closed = shortestPathFinder->lastAdditionToClose;
+                      grid.changeCellTexture( {closed.x, closed.y} , {2,1} );
+                      for( const auto& pos : shortestPathFinder->lastAdditionsToOpen )
+                          grid.changeCellTexture( {pos.x, pos.y} , {1,1} );
 
                       grid.changeCellTexture(
                       {
@@ -234,17 +288,16 @@ int main( int argc, char *argv[] )
                 }
                 else
                 {
-                  timer = clock() - timer;
                     std::cout << "\nFinished\n";
                     std::cout << "It has taken: " << number_of_steps << " steps\n";
-                    std::cout << "With a path size of " << shortestPathFinder.getShortestPath().size() << " \n";
-                    std::cout << "In " << (float)timer/CLOCKS_PER_SEC << " seconds" << '\n';
+                    std::cout << "With a path size of " << shortestPathFinder->getShortestPath().size() << " \n";
+                    std::cout << shortestPathFinder->statistics();
 
                     // Change the texture to the blue path
-                    for( const auto& pos : shortestPathFinder.getShortestPath() )
-                        grid.changeCellTexture( pos , {0,2} );
+                    for( const auto& pos : shortestPathFinder->getShortestPath() )
+                        grid.changeCellTexture( {pos.x, pos.y} , {0,2} );
 
-                    if (!shortestPathFinder.getShortestPath().empty()){
+                    if (!shortestPathFinder->getShortestPath().empty()){
                       grid.changeCellTexture(
                       {
                           new_problem.car_position().x,
@@ -284,15 +337,18 @@ int main( int argc, char *argv[] )
 
               window.draw(finalButton);
 
-              if (shortestPathFinder.getShortestPath().empty()){
+              if (shortestPathFinder->getShortestPath().empty()){
                 finalButton.changeButtonTexture({1,0});
                 window.draw(finalButton);
               }
 
             }
 
-            // Display drawings
-            window.display();
+            // Display drawings. It can wait for the screen to refresh
+            {
+                TRACE_SCOPE( "sf::RenderWindow::display", "render" );
+                window.display();
+            }
 
         }
     }